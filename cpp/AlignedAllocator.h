@@ -0,0 +1,45 @@
+/*************************************************************
+ *
+ * AlignedAllocator
+ *
+ * A minimal allocator that gives memory aligned to ALIGN bytes
+ * (posix_memalign). OpChannelCalib uses it to keep each channel's
+ * accumulators on their own cache line.
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_ALIGNEDALLOCATOR_H
+#define GALLERY_EXAMPLE_ALIGNEDALLOCATOR_H
+
+//some standard C++ includes
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace util {
+
+  //std::allocator doesn't have to honour alignas() bigger than 16 before C++17.
+  //Use this for vectors whose elements should start on their own cache line:
+  //  std::vector<T,util::AlignedAllocator<T,64>>
+  template<class T, size_t ALIGN>
+  struct AlignedAllocator {
+    typedef T value_type;
+    template<class U> struct rebind { typedef AlignedAllocator<U,ALIGN> other; };
+
+    AlignedAllocator() {}
+    template<class U> AlignedAllocator(AlignedAllocator<U,ALIGN> const&) {}
+
+    T* allocate(size_t n){
+      void* p = nullptr;
+      if(posix_memalign(&p,ALIGN,n*sizeof(T))!=0) throw std::bad_alloc();
+      return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) { free(p); }
+
+    template<class U> bool operator==(AlignedAllocator<U,ALIGN> const&) const { return true; }
+    template<class U> bool operator!=(AlignedAllocator<U,ALIGN> const&) const { return false; }
+  };
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*************************************************************
+ *
+ * AnaTreeReader class
+ *
+ * Column reading for the flashanatree and clusteranatree
+ * schemas. See AnaTreeReader.hh for usage.
+ *
+ *************************************************************/
+
+
+#include "AnaTreeReader.hh"
+
+//some ROOT includes
+#include "TBranch.h"
+#include "TLeaf.h"
+
+namespace {
+
+  TBranch* GetBranch(TTree* tree, const char* name)
+  {
+    TBranch* br = tree->GetBranch(name);
+    if(!br)
+      throw std::runtime_error(std::string("AnaTreeReader: no branch ")+name+" in "+tree->GetName());
+    return br;
+  }
+
+  //the scalar (leaf list) branch. Read it first for every entry: it has the n_hits
+  //the jagged branches need, and then they find it already read.
+  template<class SCALARS>
+  class ScalarColumn {
+  public:
+    ScalarColumn(TTree* tree, const char* name, SCALARS& buffer, Long64_t n_entries,
+		 std::vector<SCALARS>& column, std::vector<size_t>& offsets)
+      : fBranch(GetBranch(tree,name)), fBuffer(buffer), fColumn(column), fOffsets(offsets)
+    {
+      fBranch->SetAddress(&fBuffer);
+      fColumn.clear();
+      fColumn.reserve(n_entries);
+      fOffsets.assign(1,0);
+      fOffsets.reserve(n_entries+1);
+    }
+    ~ScalarColumn() { fBranch->SetAddress(nullptr); }
+
+    //returns the number of hits in this entry
+    int Read(Long64_t entry){
+      fBranch->GetEntry(entry);
+      fColumn.push_back(fBuffer);
+      int n_hits = std::max(0,fBuffer.n_hits);
+      fOffsets.push_back(fOffsets.back()+n_hits);
+      return n_hits;
+    }
+
+  private:
+    TBranch*              fBranch;
+    SCALARS&              fBuffer;
+    std::vector<SCALARS>& fColumn;
+    std::vector<size_t>&  fOffsets;
+  };
+
+  //a jagged array branch (like 'ophit_pe[n_hits]/D'), all entries into one column.
+  template<class T>
+  class JaggedColumn {
+  public:
+    JaggedColumn(TTree* tree, const char* name, std::vector<T>& column)
+      : fBranch(GetBranch(tree,name)), fBuffer(1), fColumn(column)
+    {
+      fBranch->SetAddress(fBuffer.data());
+      fColumn.clear();
+    }
+    ~JaggedColumn() { fBranch->SetAddress(nullptr); }
+
+    //call after the scalar branch has read this entry
+    void Read(Long64_t entry, int n_hits){
+      if(n_hits>(int)fBuffer.size()){
+	fBuffer.resize(n_hits);
+	fBranch->SetAddress(fBuffer.data());
+      }
+      fBranch->GetEntry(entry);
+      fColumn.insert(fColumn.end(),fBuffer.begin(),fBuffer.begin()+n_hits);
+    }
+
+  private:
+    TBranch*        fBranch;
+    std::vector<T>  fBuffer;
+    std::vector<T>& fColumn;
+  };
+
+  //an optional fixed size array branch (like 'n_hits_pe_thr[K]/I', or a plain int, with K=1). size() is K, or 0 if it's not there.
+  class FixedColumn {
+  public:
+    FixedColumn(TTree* tree, const char* name, Long64_t n_entries, std::vector<int>& column)
+      : fBranch(tree->GetBranch(name)), fLen(0), fColumn(column)
+    {
+      TLeaf* leaf = fBranch? fBranch->GetLeaf(name) : nullptr;
+      if(leaf) fLen = leaf->GetLen();
+      if(fLen<=0){ fBranch = nullptr; fLen = 0; }
+      fBuffer.resize(std::max(1,fLen));
+      if(fBranch) fBranch->SetAddress(fBuffer.data());
+      fColumn.clear();
+      fColumn.reserve(n_entries*fLen);
+    }
+    ~FixedColumn() { if(fBranch) fBranch->SetAddress(nullptr); }
+
+    int size() const { return fLen; }
+
+    void Read(Long64_t entry){
+      if(!fBranch) return;
+      fBranch->GetEntry(entry);
+      fColumn.insert(fColumn.end(),fBuffer.begin(),fBuffer.begin()+fLen);
+    }
+
+  private:
+    TBranch*          fBranch;
+    int               fLen;
+    std::vector<int>  fBuffer;
+    std::vector<int>& fColumn;
+  };
+
+}
+
+void util::FlashAnaTreeColumns::Read(TTree* tree, Long64_t first, Long64_t last)
+{
+  ScalarColumn<Scalars> flash(tree,"flash",fBuffer,last-first,fScalars,fOffsets);
+  JaggedColumn<double>  ophit_time(tree,"ophit_time",fOphitTime);
+  JaggedColumn<double>  ophit_pe(tree,"ophit_pe",fOphitPE);
+  JaggedColumn<int>     ophit_chan(tree,"ophit_chan",fOphitChan);
+  FixedColumn           n_hits_pe_thr(tree,"n_hits_pe_thr",last-first,fNHitsThr);
+
+  //one pass over the entries, all branches of an entry together
+  for(Long64_t i_e=first; i_e<last; ++i_e){
+    int n_hits = flash.Read(i_e);
+    ophit_time.Read(i_e,n_hits);
+    ophit_pe.Read(i_e,n_hits);
+    ophit_chan.Read(i_e,n_hits);
+    n_hits_pe_thr.Read(i_e);
+  }
+  fNThr = n_hits_pe_thr.size();
+}
+
+util::FlashEntry util::FlashAnaTreeColumns::Get(size_t i) const
+{
+  auto const& s = fScalars[i];
+  size_t const off = fOffsets[i];
+
+  FlashEntry e;
+  e.time = s.time; e.pe = s.pe; e.y = s.y; e.z = s.z;
+  e.n_hits = fOffsets[i+1]-off;
+  e.n_hits_2pe = s.n_hits_2pe;
+  e.ophit_time = fOphitTime.data()+off;
+  e.ophit_pe   = fOphitPE.data()+off;
+  e.ophit_chan = fOphitChan.data()+off;
+  e.n_pe_thr      = fNThr;
+  e.n_hits_pe_thr = fNHitsThr.data()+i*fNThr;
+  return e;
+}
+
+void util::ClusterAnaTreeColumns::Read(TTree* tree, Long64_t first, Long64_t last)
+{
+  ScalarColumn<Scalars> cluster(tree,"cluster",fBuffer,last-first,fScalars,fOffsets);
+  JaggedColumn<float>   hit_time(tree,"hit_time",fHitTime);
+  JaggedColumn<float>   hit_amp(tree,"hit_amp",fHitAmp);
+  JaggedColumn<float>   hit_integral(tree,"hit_integral",fHitIntegral);
+  FixedColumn           n_hits_integral_thr(tree,"n_hits_integral_thr",last-first,fNHitsThr);
+  FixedColumn           n_hits_shared(tree,"n_hits_shared",last-first,fNHitsShared);
+
+  //one pass over the entries, all branches of an entry together
+  for(Long64_t i_e=first; i_e<last; ++i_e){
+    int n_hits = cluster.Read(i_e);
+    hit_time.Read(i_e,n_hits);
+    hit_amp.Read(i_e,n_hits);
+    hit_integral.Read(i_e,n_hits);
+    n_hits_integral_thr.Read(i_e);
+    n_hits_shared.Read(i_e);
+  }
+  fNThr = n_hits_integral_thr.size();
+}
+
+util::ClusterEntry util::ClusterAnaTreeColumns::Get(size_t i) const
+{
+  auto const& s = fScalars[i];
+  size_t const off = fOffsets[i];
+
+  ClusterEntry e;
+  e.integral_sum = s.integral_sum; e.integral_ave = s.integral_ave; e.integral_std = s.integral_std;
+  e.n_hits = fOffsets[i+1]-off;
+  e.n_hits_75 = s.n_hits_75;
+  e.index = s.index;
+  e.hit_time     = fHitTime.data()+off;
+  e.hit_amp      = fHitAmp.data()+off;
+  e.hit_integral = fHitIntegral.data()+off;
+  e.n_integral_thr      = fNThr;
+  e.n_hits_integral_thr = fNHitsThr.data()+i*fNThr;
+  e.n_hits_shared = fNHitsShared.empty()? -1 : fNHitsShared[i];
+  return e;
+}
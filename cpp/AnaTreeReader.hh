@@ -0,0 +1,298 @@
+/*************************************************************
+ *
+ * AnaTreeReader class
+ *
+ * A reader for the output trees our demos write:
+ *   - flashanatree   (demo_ReadOpFlashes_MakeTree, SimpleOpFlashAna)
+ *   - clusteranatree (demo_ReadClusters_MakeTree)
+ * for second-stage plotting, without SetBranchAddress loops.
+ *
+ * It splits the tree into entry ranges, one per thread, and each
+ * thread reads its range one TTree cluster at a time (through a
+ * TTreeCache, so the baskets come in with a few big reads) into
+ * flat columns, including the jagged ophit_* and hit_* arrays.
+ * Your code then runs over those columns, not over GetEntry().
+ * Each thread fills its own copy of your histograms/accumulators,
+ * and we add them up at the end.
+ *
+ * (ROOT's bulk reading API doesn't do leaf lists or variable size
+ * arrays, so underneath it's still branch GetEntry() calls, one
+ * pass per cluster. The scalar branch goes first for every entry,
+ * so the arrays find their n_hits already read.)
+ *
+ * Usage:
+ *
+ *   util::FlashAnaTreeReader reader("demo_SimpleOpFlashAna_output.root");
+ *   TH1F h_pe("h_pe","",100,0,500);
+ *   reader.AddHist(&h_pe,
+ *                  [](util::FlashEntry const& f){ return f.pe; },       //what to fill
+ *                  [](util::FlashEntry const& f){ return f.n_hits>2; }); //selection (optional)
+ *   reader.Run(8);
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_ANATREEREADER_HH
+#define GALLERY_EXAMPLE_ANATREEREADER_HH
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+
+//some ROOT includes
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TH1.h"
+
+namespace util {
+
+  //one entry (one flash) of the flashanatree. Arrays have n_hits entries.
+  struct FlashEntry{
+    double time;
+    double pe;
+    double y;
+    double z;
+    int    n_hits;
+    int    n_hits_2pe;
+
+    double const* ophit_time;
+    double const* ophit_pe;
+    int    const* ophit_chan;
+
+    int        n_pe_thr;       //number of entries in n_hits_pe_thr (0 if the tree doesn't have it)
+    int const* n_hits_pe_thr;
+  };
+
+  //one entry (one cluster) of the clusteranatree. Arrays have n_hits entries.
+  struct ClusterEntry{
+    float        integral_sum;
+    float        integral_ave;
+    float        integral_std;
+    int          n_hits;
+    int          n_hits_75;
+    unsigned int index;
+
+    float const* hit_time;
+    float const* hit_amp;
+    float const* hit_integral;
+
+    int        n_integral_thr; //number of entries in n_hits_integral_thr (0 if the tree doesn't have it)
+    int const* n_hits_integral_thr;
+
+    int        n_hits_shared;  //hits also in other clusters (-1 if the tree doesn't have it)
+  };
+
+  //A block of consecutive tree entries, read column by column.
+  class FlashAnaTreeColumns {
+  public:
+    typedef FlashEntry Entry_t;
+    static const char* TreeName() { return "flashanatree"; }
+
+    void   Read(TTree* tree, Long64_t first, Long64_t last);
+    size_t size() const { return fScalars.size(); }
+    Entry_t Get(size_t i) const;
+
+  private:
+    //must match the "flash" branch leaf list
+    struct Scalars{ double time, pe, y, z; int n_hits, n_hits_2pe; };
+
+    Scalars              fBuffer; //the flash branch reads into here
+    std::vector<Scalars> fScalars;
+    std::vector<size_t>  fOffsets; //where each entry's hits start in the arrays below
+    std::vector<double>  fOphitTime;
+    std::vector<double>  fOphitPE;
+    std::vector<int>     fOphitChan;
+    int                  fNThr = 0;
+    std::vector<int>     fNHitsThr;
+  };
+
+  class ClusterAnaTreeColumns {
+  public:
+    typedef ClusterEntry Entry_t;
+    static const char* TreeName() { return "clusteranatree"; }
+
+    void   Read(TTree* tree, Long64_t first, Long64_t last);
+    size_t size() const { return fScalars.size(); }
+    Entry_t Get(size_t i) const;
+
+  private:
+    //must match the "cluster" branch leaf list
+    struct Scalars{ float integral_sum, integral_ave, integral_std; int n_hits, n_hits_75; unsigned int index; };
+
+    Scalars              fBuffer; //the cluster branch reads into here
+    std::vector<Scalars> fScalars;
+    std::vector<size_t>  fOffsets;
+    std::vector<float>   fHitTime;
+    std::vector<float>   fHitAmp;
+    std::vector<float>   fHitIntegral;
+    int                  fNThr = 0;
+    std::vector<int>     fNHitsThr;
+    std::vector<int>     fNHitsShared;
+  };
+
+  template<class COLUMNS> class AnaTreeReader;
+
+  typedef AnaTreeReader<FlashAnaTreeColumns>   FlashAnaTreeReader;
+  typedef AnaTreeReader<ClusterAnaTreeColumns> ClusterAnaTreeReader;
+}
+
+template<class COLUMNS>
+class util::AnaTreeReader {
+
+public:
+
+  typedef typename COLUMNS::Entry_t             Entry_t;
+  typedef std::function<bool(Entry_t const&)>   Selection_t;
+  typedef std::function<double(Entry_t const&)> Value_t;
+  typedef std::function<double(Entry_t const&,int)> HitValue_t;
+
+  AnaTreeReader(std::string const& filename, std::string const& treename=COLUMNS::TreeName())
+    : fFileName(filename), fTreeName(treename)
+  {
+    //every thread opens its own file, so ROOT needs to know
+    ROOT::EnableThreadSafety();
+
+    std::unique_ptr<TFile> f(TFile::Open(fFileName.c_str(),"READ"));
+    TTree* tree = nullptr;
+    if(f) f->GetObject(fTreeName.c_str(),tree);
+    if(!tree)
+      throw std::runtime_error("AnaTreeReader: no tree "+fTreeName+" in "+fFileName);
+    fNEntries = tree->GetEntries();
+  }
+
+  Long64_t GetEntries() const { return fNEntries; }
+
+  //fill 'hist' with value(entry), for entries passing sel
+  void AddHist(TH1* hist, Value_t value, Selection_t sel=nullptr){
+    fFills.push_back( [value,sel](TH1* h, Entry_t const& e){
+	if(!sel || sel(e)) h->Fill(value(e)); } );
+    fHists.push_back(hist);
+  }
+
+  //fill 'hist' with value(entry,i_hit) for every hit, for entries passing sel
+  void AddHistPerHit(TH1* hist, HitValue_t value, Selection_t sel=nullptr){
+    fFills.push_back( [value,sel](TH1* h, Entry_t const& e){
+	if(sel && !sel(e)) return;
+	for(int i_h=0; i_h<e.n_hits; ++i_h) h->Fill(value(e,i_h)); } );
+    fHists.push_back(hist);
+  }
+
+  //fill all the histograms we were given, using n_threads threads
+  void Run(unsigned int n_threads);
+
+  //the general version: every thread gets a copy of 'init', calls fill(acc,entry)
+  //for each entry in its range, and then we merge(result,acc) them all together.
+  template<class ACC, class FILL, class MERGE>
+  ACC Reduce(unsigned int n_threads, ACC const& init, FILL fill, MERGE merge) const;
+
+private:
+
+  typedef std::function<void(TH1*,Entry_t const&)> Fill_t;
+
+  //runs fill over the tree, one thread (and one entry range) per accumulator
+  template<class ACC>
+  void Process(std::vector<ACC>& accs, std::function<void(ACC&,Entry_t const&)> const& fill) const;
+
+  std::string         fFileName;
+  std::string         fTreeName;
+  Long64_t            fNEntries;
+  std::vector<Fill_t> fFills;
+  std::vector<TH1*>   fHists;
+};
+
+template<class COLUMNS>
+template<class ACC>
+void util::AnaTreeReader<COLUMNS>::Process(std::vector<ACC>& accs,
+					   std::function<void(ACC&,Entry_t const&)> const& fill) const
+{
+  size_t const n_threads = accs.size();
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(n_threads);
+
+  for(size_t i_t=0; i_t<n_threads; ++i_t){
+    Long64_t first = fNEntries*i_t/n_threads;
+    Long64_t last  = fNEntries*(i_t+1)/n_threads;
+
+    threads.emplace_back([this,first,last,&fill,&acc=accs[i_t],&error=errors[i_t]](){
+      try{
+	std::unique_ptr<TFile> f(TFile::Open(fFileName.c_str(),"READ"));
+	TTree* tree = nullptr;
+	if(f && !f->IsZombie()) f->GetObject(fTreeName.c_str(),tree);
+	if(!tree)
+	  throw std::runtime_error("AnaTreeReader: could not read tree "+fTreeName+" from "+fFileName);
+
+	//read everything for our range through the cache, in as few reads as we can
+	tree->SetCacheSize(32*1024*1024);
+	tree->AddBranchToCache("*",true);
+	tree->SetCacheEntryRange(first,last);
+
+	//one TTree cluster at a time: that's how the baskets line up on disk
+	COLUMNS columns;
+	auto clusters = tree->GetClusterIterator(first);
+	Long64_t start;
+	while( (start = clusters()) < last ){
+	  Long64_t end = std::min(clusters.GetNextEntry(),last);
+	  columns.Read(tree,std::max(start,first),end);
+	  for(size_t i_e=0; i_e<columns.size(); ++i_e)
+	    fill(acc,columns.Get(i_e));
+	}
+      }
+      catch(...){ error = std::current_exception(); } //an exception can't leave a thread
+      });
+  }
+  for(auto & t : threads) t.join();
+
+  //pass on the first thing that went wrong
+  for(auto const& error : errors)
+    if(error) std::rethrow_exception(error);
+}
+
+template<class COLUMNS>
+template<class ACC, class FILL, class MERGE>
+ACC util::AnaTreeReader<COLUMNS>::Reduce(unsigned int n_threads, ACC const& init,
+					 FILL fill, MERGE merge) const
+{
+  std::vector<ACC> accs(std::max(1u,n_threads),init);
+  Process<ACC>(accs,fill);
+
+  ACC result(accs[0]);
+  for(size_t i_t=1; i_t<accs.size(); ++i_t)
+    merge(result,accs[i_t]);
+  return result;
+}
+
+template<class COLUMNS>
+void util::AnaTreeReader<COLUMNS>::Run(unsigned int n_threads)
+{
+  //every thread gets its own copy of every histogram. Make them here,
+  //on this thread, and keep them out of any directory.
+  std::vector< std::vector<TH1*> > thread_hists(std::max(1u,n_threads));
+  for(auto & hists : thread_hists)
+    for(auto h : fHists){
+      TH1* h_clone = static_cast<TH1*>(h->Clone());
+      h_clone->SetDirectory(nullptr);
+      h_clone->Reset();
+      hists.push_back(h_clone);
+    }
+
+  auto const& fills = fFills;
+  Process< std::vector<TH1*> >(thread_hists,
+			       [&fills](std::vector<TH1*>& hists, Entry_t const& e){
+				 for(size_t i_h=0; i_h<fills.size(); ++i_h) fills[i_h](hists[i_h],e);
+			       });
+
+  //add them all up into the histograms we were given
+  for(auto & hists : thread_hists)
+    for(size_t i_h=0; i_h<fHists.size(); ++i_h){
+      fHists[i_h]->Add(hists[i_h]);
+      delete hists[i_h];
+    }
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*************************************************************
+ *
+ * ArgParser class
+ *
+ * The command line for our demos: '--name=value' options, '--name'
+ * switches, and plain (positional) numbers. Every part of a program asks for
+ * the options it knows about, and at the end Done() checks that
+ * nothing was left over, so a misspelled option is an error
+ * instead of being silently ignored.
+ *
+ * Usage:
+ *
+ *   util::ArgParser args(argc,argv,"[thresholds ...] [--min-flash-pe=X]");
+ *   double min_pe = args.GetDouble("min-flash-pe",-1);
+ *   std::vector<double> thresholds = args.GetPositional();
+ *   args.Done();
+ *
+ * Anything wrong prints the problem and the usage line, and exits.
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_ARGPARSER_H
+#define GALLERY_EXAMPLE_ARGPARSER_H
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <set>
+#include <iostream>
+#include <stdexcept>
+#include <stdlib.h>
+
+namespace util { class ArgParser; }
+
+class util::ArgParser {
+
+public:
+
+  ArgParser(int argc, char** argv, std::string const& usage)
+    : fProgram(argc>0? argv[0] : ""), fUsage(usage), fPositionalUsed(false)
+  {
+    for(int i_arg=1; i_arg<argc; ++i_arg){
+      std::string arg(argv[i_arg]);
+      if(arg.compare(0,2,"--")==0) fOptions.push_back(arg.substr(2));
+      else                         fPositional.push_back(arg);
+    }
+  }
+
+  //'--name=value'. Returns def if it's not there.
+  double GetDouble(std::string const& name, double def){
+    std::string value;
+    return Find(name,value)? ToDouble(value,"--"+name) : def;
+  }
+  long long GetInt(std::string const& name, long long def){
+    std::string value;
+    if(!Find(name,value)) return def;
+    size_t n_read = 0;
+    long long result = 0;
+    try{ result = std::stoll(value,&n_read); }
+    catch(std::exception const&){ n_read = 0; }
+    if(n_read==0 || n_read!=value.size())
+      Fail("'--"+name+"' needs a whole number, not '"+value+"'");
+    return result;
+  }
+
+  //'--name', on its own
+  bool GetFlag(std::string const& name){
+    fKnown.insert(name);
+    bool found = false;
+    for(auto const& opt : fOptions){
+      if(opt.compare(0,name.size()+1,name+"=")==0) Fail("'--"+name+"' doesn't take a value");
+      if(opt==name) found = true;
+    }
+    return found;
+  }
+
+  //all the plain numbers on the command line
+  std::vector<double> GetPositional(){
+    fPositionalUsed = true;
+    std::vector<double> values;
+    for(auto const& arg : fPositional) values.push_back(ToDouble(arg,"argument"));
+    return values;
+  }
+
+  //call when everyone has asked for their options
+  void Done() const {
+    for(auto const& opt : fOptions)
+      if(fKnown.count(opt.substr(0,opt.find('=')))==0)
+	Fail("unknown option '--"+opt+"'");
+    if(!fPositionalUsed && !fPositional.empty())
+      Fail("unexpected argument '"+fPositional.front()+"'");
+  }
+
+  void Fail(std::string const& what) const {
+    std::cerr << fProgram << ": " << what << "\n"
+	      << "Usage: " << fProgram << " " << fUsage << std::endl;
+    exit(1);
+  }
+
+private:
+
+  //finds '--name=value'. (The last one counts, if it's there twice.)
+  bool Find(std::string const& name, std::string& value){
+    fKnown.insert(name);
+    bool found = false;
+    for(auto const& opt : fOptions){
+      if(opt==name) Fail("'--"+name+"' needs a value: '--"+name+"=...'");
+      if(opt.compare(0,name.size()+1,name+"=")==0){
+	value = opt.substr(name.size()+1);
+	found = true;
+      }
+    }
+    return found;
+  }
+
+  double ToDouble(std::string const& value, std::string const& what) const {
+    size_t n_read = 0;
+    double result = 0;
+    try{ result = std::stod(value,&n_read); }
+    catch(std::exception const&){ n_read = 0; }
+    if(n_read==0 || n_read!=value.size())
+      Fail(what+" needs a number, not '"+value+"'");
+    return result;
+  }
+
+  std::string              fProgram;
+  std::string              fUsage;
+  std::vector<std::string> fOptions;    //without the leading '--'
+  std::vector<std::string> fPositional;
+  bool                     fPositionalUsed;
+  std::set<std::string>    fKnown;
+};
+
+#endif
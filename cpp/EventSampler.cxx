@@ -0,0 +1,196 @@
+/*************************************************************
+ *
+ * EventSampler class
+ *
+ * A reproducible, uniform random sample of the events in a list
+ * of files, for quick previews. See EventSampler.hh for usage.
+ *
+ *************************************************************/
+
+
+#include "EventSampler.hh"
+
+//some standard C++ includes
+#include <random>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+//some ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+
+util::EventSampler::EventSampler()
+  : fSampling(false), fNTotal(0), fSeed(0), fNext(0)
+{}
+
+util::EventSampler::EventSampler(std::vector<std::string> const& filenames, unsigned long seed)
+  : fSampling(true), fNTotal(0), fSeed(seed), fNext(0)
+{
+  //just the number of entries in each event tree: we don't read any events here
+  for(auto const& fname : filenames){
+    std::unique_ptr<TFile> f(TFile::Open(fname.c_str(),"READ"));
+    TTree* tree = nullptr;
+    if(f && !f->IsZombie()) f->GetObject("Events",tree);
+    if(!tree)
+      throw std::runtime_error("EventSampler: no Events tree in "+fname);
+    fNPerFile.push_back(tree->GetEntries());
+    fNTotal += fNPerFile.back();
+  }
+}
+
+void util::EventSampler::Draw(long long n_sample)
+{
+  n_sample = std::max(0LL,std::min(n_sample,fNTotal));
+  fSample.clear();
+  fSample.reserve(n_sample);
+
+  //Knuth's selection sampling: walk through all events once, and take each one with
+  //probability (still needed)/(still left). Every subset of n_sample events is equally
+  //likely, and they come out in file/entry order.
+  std::mt19937_64 rng(fSeed);
+  std::uniform_real_distribution<double> uniform(0.,1.);
+  long long n_left = fNTotal, n_needed = n_sample;
+  for(size_t i_f=0; i_f<fNPerFile.size() && n_needed>0; ++i_f)
+    for(long long i_e=0; i_e<fNPerFile[i_f] && n_needed>0; ++i_e, --n_left)
+      if(n_left*uniform(rng) < n_needed){
+	fSample.emplace_back(i_f,i_e);
+	--n_needed;
+      }
+  fNext = 0;
+}
+
+util::EventSampler util::EventSampler::All()
+{
+  return EventSampler();
+}
+
+util::EventSampler util::EventSampler::Fraction(std::vector<std::string> const& filenames,
+						double fraction, unsigned long seed)
+{
+  if(fraction>=1) return All();
+  EventSampler sampler(filenames,seed);
+  sampler.Draw(std::llround(std::min(1.,std::max(0.,fraction))*sampler.fNTotal));
+  return sampler;
+}
+
+util::EventSampler util::EventSampler::Count(std::vector<std::string> const& filenames,
+					     long long n_sample, unsigned long seed)
+{
+  EventSampler sampler(filenames,seed);
+  sampler.Draw(n_sample);
+  return sampler;
+}
+
+util::EventSampler util::EventSampler::FromArgs(util::ArgParser& args,
+						std::vector<std::string> const& filenames)
+{
+  double fraction = args.GetDouble("sample-fraction",-1);
+  long long count = args.GetInt("sample-count",-1);
+  long long seed  = args.GetInt("seed",1);
+  if(fraction>=0 && count>=0) args.Fail("give '--sample-fraction' or '--sample-count', not both");
+  if(seed<0) args.Fail("'--seed' can't be negative");
+  if(count>=0) return Count(filenames,count,seed);
+  if(fraction>=0) return Fraction(filenames,fraction,seed);
+  return All();
+}
+
+bool util::EventSampler::GoToNext(gallery::Event& ev)
+{
+  //not sampling: the plain ev.next() loop
+  if(!fSampling){
+    if(fNext++>0) ev.next();
+    return !ev.atEnd();
+  }
+
+  if(fNext>0) EndEvent();
+  if(fNext>=fSample.size()) return false;
+  auto const& target = fSample[fNext++];
+
+  //get to the right file: jump to the last event in this one, and step over.
+  while(!ev.atEnd() && (size_t)ev.fileEntry()<target.first){
+    ev.goToEntry(ev.numberOfEventsInFile()-1);
+    ev.next();
+  }
+  if(ev.atEnd()) return false;
+
+  //and then straight to the entry we want
+  if(ev.eventEntry()!=target.second) ev.goToEntry(target.second);
+  return true;
+}
+
+void util::EventSampler::PrepareHist(TH1* h, bool show_under_overflow)
+{
+  if(!IsPreview()) return;
+  if(show_under_overflow && h->GetDimension()!=1)
+    throw std::runtime_error(std::string("EventSampler::PrepareHist: can only fold under/overflow in 1D, not ")+h->GetName());
+  h->Sumw2();
+  std::vector<double> zeros(h->GetNcells(),0);
+  fHists.push_back( HistSums{h,show_under_overflow,zeros,zeros,zeros} );
+}
+
+void util::EventSampler::Fold(std::vector<double>& cells)
+{
+  //same as ShowUnderOverFlow: cells are [underflow, 1..nbins, overflow]
+  size_t const nbins = cells.size()-2;
+  cells[1] += cells[0];           cells[0] = 0;
+  cells[nbins] += cells[nbins+1]; cells[nbins+1] = 0;
+}
+
+void util::EventSampler::EndEvent()
+{
+  for(auto & hs : fHists){
+    for(int i_b=0; i_b<hs.h->GetNcells(); ++i_b){
+      double const content = hs.h->GetBinContent(i_b);
+      hs.y[i_b] = content-hs.last[i_b];
+      hs.last[i_b] = content;
+    }
+    //an event in the underflow and one in the first bin are the same bin to us,
+    //so they need to be added up before squaring
+    if(hs.fold) Fold(hs.y);
+    for(size_t i_b=0; i_b<hs.y.size(); ++i_b)
+      hs.sum_y2[i_b] += hs.y[i_b]*hs.y[i_b];
+  }
+}
+
+void util::EventSampler::ScaleHist(TH1* h) const
+{
+  if(!IsPreview()) return;
+
+  auto hs = std::find_if(fHists.begin(),fHists.end(),[h](HistSums const& s){ return s.h==h; });
+  if(hs==fHists.end())
+    throw std::runtime_error(std::string("EventSampler::ScaleHist: call PrepareHist before filling ")+h->GetName());
+
+  //first move the under/overflow into the edge bins (a later ShowUnderOverFlow is then a no-op)
+  std::vector<double> sum_y = hs->last;
+  if(hs->fold){
+    Fold(sum_y);
+    for(int i_b : { 0, 1, h->GetNbinsX(), h->GetNbinsX()+1 })
+      h->SetBinContent(i_b,sum_y[i_b]);
+  }
+
+  //each bin's total is estimated as N*(mean per-event count y over the n sampled events).
+  //Its variance is N^2*(1-f)*s^2/n, with s^2 the sample variance of y, and (1-f) because
+  //we sample without replacement (f=n/N). This counts a flash-level bin right too: all
+  //the flashes of an event come in together.
+  double const w = GetWeight();
+  double const n = GetNSample();
+  double const fpc = 1.-n/fNTotal;
+  h->Scale(w);
+  for(int i_b=0; i_b<h->GetNcells(); ++i_b){
+    double const s2 = n>1? std::max(0.,(hs->sum_y2[i_b]-sum_y[i_b]*sum_y[i_b]/n)/(n-1)) : hs->sum_y2[i_b];
+    h->SetBinError(i_b,w*std::sqrt(n*fpc*s2));
+  }
+}
+
+void util::EventSampler::PrintReport(std::ostream& os) const
+{
+  if(!fSampling)
+    os << "EventSampler: not sampling, all events." << std::endl;
+  else if(IsPreview())
+    os << "EventSampler: PREVIEW of " << GetNSample() << " / " << fNTotal
+       << " events (seed " << fSeed << "). Histograms scaled by " << GetWeight() << "." << std::endl;
+  else
+    os << "EventSampler: all " << fNTotal << " events." << std::endl;
+}
@@ -0,0 +1,131 @@
+/*************************************************************
+ *
+ * EventSampler class
+ *
+ * A preview mode for the demos: process a uniform random sample
+ * of the events in ALL the files (not just the first N events,
+ * which are all from the first files), and jump straight to the
+ * sampled entries instead of reading through the rest.
+ *
+ * The sample is reproducible: the same files, size and seed
+ * give the same events.
+ *
+ * Without sampling options it stays out of the way: no files
+ * are opened up front, and GoToNext() is just ev.next().
+ *
+ * Histograms filled from the sample get scaled up to the full
+ * dataset, with the statistical uncertainty of the sampling:
+ * call PrepareHist() on them before filling, and ScaleHist()
+ * at the end. We sample events, not flashes: the flashes of one
+ * event all come in (or not) together. So the uncertainty comes
+ * from how much each bin's per-event count varies from event to
+ * event, which works for per-event and per-flash histograms
+ * alike. Fill only between GoToNext() calls; weights are fine.
+ *
+ * If you would ShowUnderOverFlow() a histogram, tell PrepareHist()
+ * instead, and ScaleHist() moves the under/overflow into the edge
+ * bins itself, with the right errors for the combined bins.
+ *
+ * Usage:
+ *
+ *   util::ArgParser args(argc,argv,"[--sample-fraction=F | --sample-count=N] [--seed=N]");
+ *   auto sampler = util::EventSampler::FromArgs(args,filenames);
+ *   sampler.PrepareHist(h,true);
+ *   for (gallery::Event ev(filenames); sampler.GoToNext(ev); ) { ... }
+ *   sampler.ScaleHist(h);
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_EVENTSAMPLER_HH
+#define GALLERY_EXAMPLE_EVENTSAMPLER_HH
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <utility>
+#include <ostream>
+
+//some ROOT includes
+#include "TH1.h"
+
+//"art" includes (canvas, and gallery)
+#include "gallery/Event.h"
+
+//our own includes!
+#include "ArgParser.h"
+
+namespace util { class EventSampler; }
+
+class util::EventSampler {
+
+public:
+
+  //sample a fraction of all the events (1 means all of them, in order)
+  static EventSampler Fraction(std::vector<std::string> const& filenames, double fraction, unsigned long seed=1);
+
+  //sample this many events
+  static EventSampler Count(std::vector<std::string> const& filenames, long long n_sample, unsigned long seed=1);
+
+  //no sampling: every event, in order
+  static EventSampler All();
+
+  //reads '--sample-fraction=F', '--sample-count=N' and '--seed=S' off the command line.
+  //Without any of those, you get All().
+  static EventSampler FromArgs(util::ArgParser& args, std::vector<std::string> const& filenames);
+
+  //moves ev to the next event in the sample. Returns false when we are done.
+  bool GoToNext(gallery::Event& ev);
+
+  long long GetNTotal()  const { return fNTotal; }
+  long long GetNSample() const { return fSample.size(); }
+  bool      IsPreview()  const { return fSampling && GetNSample()<fNTotal; }
+
+  //each sampled event stands for this many events
+  double GetWeight() const { return fSample.empty()? 0 : double(fNTotal)/fSample.size(); }
+
+  //call before filling (we start keeping track of the per-event counts in each bin),
+  //and when done filling (scales up to the full dataset, and sets the errors).
+  //With show_under_overflow (1D only), the under/overflow bins count as part of the
+  //first/last bins, and ScaleHist() moves them there.
+  void PrepareHist(TH1*, bool show_under_overflow=false);
+  void ScaleHist(TH1*) const;
+
+  void PrintReport(std::ostream&) const;
+
+private:
+
+  //no sampling
+  EventSampler();
+
+  //counts the events in each file
+  EventSampler(std::vector<std::string> const& filenames, unsigned long seed);
+
+  //picks n_sample of them
+  void Draw(long long n_sample);
+
+  //adds what the last event put in each bin of our histograms to the sums of squares
+  void EndEvent();
+
+  //per histogram: bin contents after the last event, and the sum over events of
+  //(what that event put in the bin)^2
+  struct HistSums{
+    TH1*                h;
+    bool                fold;   //under/overflow go into the first/last bins
+    std::vector<double> last;
+    std::vector<double> sum_y2;
+    std::vector<double> y;      //scratch: what the last event put in each bin
+  };
+
+  //adds the under/overflow to the first/last bins, for the cells of a 1D histogram
+  static void Fold(std::vector<double>& cells);
+
+  bool           fSampling;
+  std::vector<long long> fNPerFile;
+  long long      fNTotal;
+  unsigned long  fSeed;
+  std::vector< std::pair<size_t,long long> > fSample; //(file, entry in file), in order
+  size_t         fNext;
+  std::vector<HistSums> fHists;
+};
+
+#endif
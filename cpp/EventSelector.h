@@ -0,0 +1,131 @@
+/*************************************************************
+ *
+ * EventSelector class
+ *
+ * A two-phase event selection. You declare cuts that only look
+ * at cheap information (the eventAuxiliary(), or light products
+ * like vector<recob::OpFlash>), and the "heavy" products you
+ * would read after the cuts. Check Select(ev) before touching
+ * the heavy products: gallery reads products lazily, so for
+ * events that fail, those products are never read or unzipped.
+ *
+ * At the end, PrintReport() tells you how many events passed
+ * each cut, and about how many bytes of the heavy products we
+ * didn't unzip and stream. That's not necessarily disk reads
+ * we avoided: with gallery's TTreeCache on (the default), the
+ * baskets of branches read for selected events get fetched for
+ * the neighbouring rejected events too. To save the disk reads
+ * as well, make the gallery::Event with the cache off:
+ * gallery::Event ev(filenames,false).
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_EVENTSELECTOR_H
+#define GALLERY_EXAMPLE_EVENTSELECTOR_H
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <functional>
+#include <ostream>
+
+//some ROOT includes
+#include "TTree.h"
+#include "TBranch.h"
+
+//"art" includes (canvas, and gallery)
+#include "canvas/Utilities/InputTag.h"
+#include "canvas/Utilities/TypeID.h"
+#include "gallery/Event.h"
+
+//our own includes!
+#include "ProductBranch.h"
+
+namespace util { class EventSelector; }
+
+class util::EventSelector {
+
+public:
+
+  typedef std::function<bool(gallery::Event const&)> Predicate_t;
+
+  //cuts are checked in the order they are added, and we stop at the first one that fails.
+  void AddCut(std::string const& name, Predicate_t cut)
+  { fCuts.push_back( Cut{name,cut,0} ); }
+
+  //tell us about a product you only read for selected events, so we can count what we saved.
+  template<class PROD>
+  void AddHeavyProduct(art::InputTag const& tag)
+  { fHeavy.push_back( HeavyProduct(art::TypeID(typeid(PROD)).friendlyClassName(),tag) ); }
+
+  bool Select(gallery::Event const& ev){
+    ++fNEvents;
+    for(auto & cut : fCuts){
+      if(!cut.predicate(ev)){
+	Skip(ev);
+	return false;
+      }
+      ++cut.n_pass;
+    }
+    ++fNSelected;
+    return true;
+  }
+
+  void PrintReport(std::ostream& os) const{
+    os << "EventSelector report: " << fNSelected << " / " << fNEvents << " events selected\n";
+    for(auto const& cut : fCuts)
+      os << "\tpassed '" << cut.name << "': " << cut.n_pass << "\n";
+
+    double total_zip=0, total_tot=0;
+    for(auto const& prod : fHeavy){
+      os << "\tskipped " << prod.friendly_name << " '" << prod.tag.encode() << "': ~"
+	 << prod.skipped_zip/1024. << " kB compressed, ~" << prod.skipped_tot/1024. << " kB unzipped\n";
+      total_zip += prod.skipped_zip;
+      total_tot += prod.skipped_tot;
+    }
+    os << "\tTotal not unzipped/streamed: ~" << total_zip/1024./1024. << " MB compressed, ~"
+       << total_tot/1024./1024. << " MB unzipped"
+       << " (not all of it is disk reads saved, if the TTreeCache is on)" << std::endl;
+  }
+
+private:
+
+  struct Cut{
+    std::string   name;
+    Predicate_t   predicate;
+    unsigned long n_pass;
+  };
+
+  struct HeavyProduct{
+    std::string    friendly_name;
+    art::InputTag  tag;
+    long long      file_entry;  //the input file we last looked up the branch in
+    double         zip_per_entry;
+    double         tot_per_entry;
+    double         skipped_zip;
+    double         skipped_tot;
+    HeavyProduct(std::string const& fn, art::InputTag const& t)
+      : friendly_name(fn), tag(t), file_entry(-1),
+	zip_per_entry(0), tot_per_entry(0), skipped_zip(0), skipped_tot(0) {}
+  };
+
+  //the branch sizes are per file averages, so this is an estimate of what we saved.
+  void Skip(gallery::Event const& ev){
+    for(auto & prod : fHeavy){
+      if(FileChanged(ev,prod.file_entry)){
+	TBranch* br = FindProductBranch(ev.getTTree(),prod.friendly_name,prod.tag);
+	prod.zip_per_entry = ZipBytesPerEntry(br);
+	prod.tot_per_entry = TotBytesPerEntry(br);
+      }
+      prod.skipped_zip += prod.zip_per_entry;
+      prod.skipped_tot += prod.tot_per_entry;
+    }
+  }
+
+  std::vector<Cut>          fCuts;
+  std::vector<HeavyProduct> fHeavy;
+  unsigned long             fNEvents = 0;
+  unsigned long             fNSelected = 0;
+};
+
+#endif
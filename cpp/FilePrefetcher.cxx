@@ -0,0 +1,164 @@
+/*************************************************************
+ *
+ * FilePrefetcher class
+ *
+ * Opens the next file(s) in a gallery input list on a helper
+ * thread, while the current file is being processed, and times
+ * the file boundaries. See FilePrefetcher.hh for usage.
+ *
+ *************************************************************/
+
+
+#include "FilePrefetcher.hh"
+
+//some standard C++ includes
+#include <chrono>
+#include <memory>
+#include <iomanip>
+
+//some ROOT includes
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+
+using namespace std::chrono;
+
+util::FilePrefetcher::FilePrefetcher(std::vector<std::string> const& filenames,
+				     size_t max_in_flight)
+  : fFileNames(filenames),
+    fMaxInFlight(max_in_flight),
+    fNextToLaunch(1), //gallery::Event opens the first file itself, in its constructor
+    fTimings(filenames.size()),
+    fInFileNextMs(0),
+    fNInFileNext(0)
+{
+  //we are going to do ROOT I/O on more than one thread now.
+  if(fMaxInFlight>0) ROOT::EnableThreadSafety();
+  TopUp();
+}
+
+util::FilePrefetcher::~FilePrefetcher()
+{
+  //don't leave helper threads running on files we never got to.
+  for(auto & f : fInFlight) f.second.wait();
+}
+
+double util::FilePrefetcher::PrefetchFile(std::string const& fname)
+{
+  auto t_begin = high_resolution_clock::now();
+
+  //opening reads the file header, streamer info and keys list. Then the MetaData
+  //tree (it's small), and the Events tree object itself, but none of its baskets.
+  std::unique_ptr<TFile> f(TFile::Open(fname.c_str(),"READ"));
+  if(f && !f->IsZombie()){
+    TTree* tree = nullptr;
+    f->GetObject("MetaData",tree);
+    if(tree) tree->LoadBaskets();
+    tree = nullptr;
+    f->GetObject("Events",tree);
+  }
+
+  duration<double,std::milli> time_prefetch_ms(high_resolution_clock::now()-t_begin);
+  return time_prefetch_ms.count();
+}
+
+void util::FilePrefetcher::Launch(size_t i_file)
+{
+  fInFlight[i_file] = std::async(std::launch::async,
+				 &util::FilePrefetcher::PrefetchFile,
+				 fFileNames[i_file]);
+}
+
+void util::FilePrefetcher::TopUp()
+{
+  while(fInFlight.size()<fMaxInFlight && fNextToLaunch<fFileNames.size())
+    Launch(fNextToLaunch++);
+}
+
+double util::FilePrefetcher::Collect(size_t i_file)
+{
+  auto it = fInFlight.find(i_file);
+  if(it==fInFlight.end()) return 0;
+  double prefetch_ms = it->second.get();
+  fInFlight.erase(it);
+  return prefetch_ms;
+}
+
+void util::FilePrefetcher::Next(gallery::Event& ev)
+{
+  size_t const i_file = ev.fileEntry();
+
+  //anything behind the current file is of no more use to us.
+  while(!fInFlight.empty() && fInFlight.begin()->first<i_file)
+    fInFlight.begin()->second.wait(), fInFlight.erase(fInFlight.begin());
+
+  //not a boundary: just time it, so we know what a normal next() costs
+  if(ev.eventEntry()+1 < ev.numberOfEventsInFile()){
+    auto t_begin = high_resolution_clock::now();
+    ev.next();
+    duration<double,std::milli> time_next_ms(high_resolution_clock::now()-t_begin);
+    fInFileNextMs += time_next_ms.count();
+    ++fNInFileNext;
+    TopUp();
+    return;
+  }
+
+  //the next call to next() opens the next file: make sure the helper is done with it.
+  auto t_begin = high_resolution_clock::now();
+  double prefetch_ms = Collect(i_file+1);
+  auto t_waited = high_resolution_clock::now();
+
+  //and this is the stall we actually see: gallery opening the file
+  ev.next();
+  auto t_end = high_resolution_clock::now();
+  if(ev.atEnd()){ TopUp(); return; }
+
+  //gallery skips files without events, so where we landed may be further on.
+  //Those files got opened in that next() too.
+  size_t const j_file = ev.fileEntry();
+  for(size_t k_file=i_file+2; k_file<=j_file; ++k_file)
+    prefetch_ms += Collect(k_file);
+
+  duration<double,std::milli> time_wait_ms(t_waited-t_begin);
+  duration<double,std::milli> time_next_ms(t_end-t_waited);
+  auto & timing = fTimings[j_file];
+  timing.prefetch_ms = prefetch_ms;
+  timing.wait_ms     = time_wait_ms.count();
+  timing.next_ms     = time_next_ms.count();
+  timing.n_skipped   = j_file-i_file-1;
+  timing.used        = true;
+
+  TopUp();
+}
+
+void util::FilePrefetcher::PrintReport(std::ostream& os) const
+{
+  double total_prefetch_ms=0, total_wait_ms=0, total_next_ms=0;
+  size_t n_used=0;
+
+  //'hidden' is the helper's work that overlapped with our processing: what it took,
+  //minus what we still had to wait for.
+  os << "FilePrefetcher report (max " << fMaxInFlight << " files in flight)\n";
+  for(size_t i_f=1; i_f<fTimings.size(); ++i_f){
+    auto const& t = fTimings[i_f];
+    if(!t.used) continue;
+    ++n_used;
+    total_prefetch_ms += t.prefetch_ms;
+    total_wait_ms += t.wait_ms;
+    total_next_ms += t.next_ms;
+    os << "\t" << fFileNames[i_f] << ": stall " << std::fixed << std::setprecision(2)
+       << (t.wait_ms+t.next_ms) << " ms (waiting for helper " << t.wait_ms
+       << " ms, next() " << t.next_ms << " ms). Prefetch took " << t.prefetch_ms
+       << " ms, hidden " << (t.prefetch_ms-t.wait_ms) << " ms";
+    if(t.n_skipped>0) os << " (through " << t.n_skipped << " empty files)";
+    os << "\n";
+  }
+  os << std::fixed << std::setprecision(2)
+     << "\tTotal over " << n_used << " file boundaries: stall " << (total_wait_ms+total_next_ms)
+     << " ms (waiting for helper " << total_wait_ms << " ms, next() " << total_next_ms
+     << " ms). Prefetch took " << total_prefetch_ms << " ms, hidden "
+     << (total_prefetch_ms-total_wait_ms) << " ms\n";
+  if(fNInFileNext>0)
+    os << "\tA next() within a file takes " << fInFileNextMs/fNInFileNext << " ms on average\n";
+  os << "\t(compare with a run with max_in_flight=0 to see what the prefetching buys you)" << std::endl;
+}
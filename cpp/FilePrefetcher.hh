@@ -0,0 +1,91 @@
+/*************************************************************
+ *
+ * FilePrefetcher class
+ *
+ * Opens the next file(s) in a gallery input list on a helper
+ * thread, while the current file is being processed, and reads
+ * just what gallery needs to open a file: the header, streamer
+ * info and keys, the MetaData tree (product registry, process
+ * history, ...) and the Events tree header. No event data.
+ *
+ * gallery::Event opens its files itself, so it can't take over
+ * the file we opened. What we gain is that those bytes are in
+ * the OS page cache when it does. That helps for local files
+ * (and network filesystems that cache); for xrootd and the like
+ * it is just a second read of the metadata, so there set
+ * max_in_flight to 0.
+ *
+ * Either way, Next() times the ev.next() calls that cross into
+ * a new file on the main thread, so you can check what it buys
+ * you: run once with max_in_flight=0, and compare the reports.
+ *
+ * Usage (construct BEFORE the gallery::Event!):
+ *
+ *   util::FilePrefetcher prefetcher(filenames,2);
+ *   for (gallery::Event ev(filenames); !ev.atEnd(); prefetcher.Next(ev)) {...}
+ *   prefetcher.PrintReport(std::cout);
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_FILEPREFETCHER_HH
+#define GALLERY_EXAMPLE_FILEPREFETCHER_HH
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <map>
+#include <future>
+#include <ostream>
+
+//"art" includes (canvas, and gallery)
+#include "gallery/Event.h"
+
+namespace util { class FilePrefetcher; }
+
+class util::FilePrefetcher {
+
+public:
+
+  //max_in_flight is the number of files allowed to be opened ahead of the current one.
+  //0 turns off the prefetching, but still measures the file boundaries.
+  FilePrefetcher(std::vector<std::string> const& filenames, size_t max_in_flight=2);
+  ~FilePrefetcher();
+
+  //use this instead of ev.next(). If we are at a file boundary, it waits for the
+  //helper to be done with the next file, and times the ev.next() that opens it.
+  void Next(gallery::Event& ev);
+
+  void PrintReport(std::ostream&) const;
+
+private:
+
+  //one per file boundary, filed under the file gallery landed in. If it had to go
+  //through empty files to get there, those are in here too.
+  struct FileTiming{
+    double prefetch_ms; //time the helper threads spent on the file(s)
+    double wait_ms;     //time the event loop waited for the helper at the boundary
+    double next_ms;     //time the ev.next() into this file took on the main thread
+    size_t n_skipped;   //empty files gallery went through on the way
+    bool   used;        //whether the event loop ever reached this file
+    FileTiming() : prefetch_ms(0), wait_ms(0), next_ms(0), n_skipped(0), used(false) {}
+  };
+
+  //waits for the helper on i_file (if there is one), and returns how long it took it
+  double Collect(size_t i_file);
+
+  void TopUp();
+  void Launch(size_t i_file);
+  static double PrefetchFile(std::string const& fname);
+
+  std::vector<std::string>          fFileNames;
+  size_t                            fMaxInFlight;
+  size_t                            fNextToLaunch;
+  std::map<size_t,std::future<double>> fInFlight;
+  std::vector<FileTiming>           fTimings;
+
+  //ev.next() calls within a file, for comparison
+  double                            fInFileNextMs;
+  long long                         fNInFileNext;
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*************************************************************
+ *
+ * HitWorkingSet class
+ *
+ * The per-event set of hits that clusters point to. In pandora
+ * output the same recob::Hit can belong to several clusters, so
+ * following each cluster's hit pointers reads shared hits more
+ * than once, and all over memory.
+ *
+ * Build() goes through the cluster->hit associations once per
+ * event, and turns every art::Ptr into a dense index (its place
+ * in the hit collection, which is also its place in memory). It
+ * counts how many clusters use each hit, reads each used hit just
+ * once (in memory order) into flat arrays, and keeps each
+ * cluster's hits as a sorted list of indices into those arrays.
+ *
+ * A cluster keeps all its associations, so if it points to the
+ * same hit twice, that hit is in its list twice (like with
+ * FindMany): per-cluster counts and sums don't change. Only the
+ * sharing counts and the event totals below look at unique
+ * hits, so shared hits are not double counted there.
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_HITWORKINGSET_H
+#define GALLERY_EXAMPLE_HITWORKINGSET_H
+
+//some standard C++ includes
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+//"art" includes (canvas)
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Persistency/Provenance/ProductID.h"
+
+//"larsoft" object includes
+#include "lardataobj/RecoBase/Hit.h"
+
+namespace util { class HitWorkingSet; }
+
+class util::HitWorkingSet {
+
+public:
+
+  typedef std::vector< art::Ptr<recob::Hit> > HitPtrs_t;
+
+  //hits_per_cluster[i_c] are the hits associated to cluster i_c (like from a FindManyP).
+  void Build(std::vector<HitPtrs_t> const& hits_per_cluster){
+
+    //1) Ptr -> dense index. Usually all hits come from one hit collection, and the
+    //   index is just the Ptr key. With more, each collection gets its own block.
+    fProducts.clear();
+    fClusterOffsets.assign(1,0);
+    fClusterHits.clear();
+    std::vector<size_t> product_of;
+    for(auto const& ptrs : hits_per_cluster)
+      for(auto const& ptr : ptrs){
+	size_t i_p = FindProduct(ptr);
+	product_of.push_back(i_p);
+	fProducts[i_p].size = std::max(fProducts[i_p].size,ptr.key()+1);
+      }
+
+    size_t n_dense = 0;
+    for(auto & p : fProducts){ p.offset = n_dense; n_dense += p.size; }
+
+    size_t i_ptr = 0;
+    for(auto const& ptrs : hits_per_cluster){
+      size_t const begin = fClusterHits.size();
+      for(auto const& ptr : ptrs)
+	fClusterHits.push_back(fProducts[product_of[i_ptr++]].offset + ptr.key());
+
+      //each cluster's hits in index (= memory) order
+      std::sort(fClusterHits.begin()+begin,fClusterHits.end());
+      fClusterOffsets.push_back(fClusterHits.size());
+    }
+
+    //2) how many clusters use each hit. A cluster with the same hit twice counts once
+    //   (the duplicates are next to each other, now that it's sorted).
+    fNClusters.assign(n_dense,0);
+    for(size_t i_c=0; i_c<NClusters(); ++i_c)
+      for(auto it = ClusterBegin(i_c); it!=ClusterEnd(i_c); ++it)
+	if(it==ClusterBegin(i_c) || *it!=*(it-1)) ++fNClusters[*it];
+
+    //3) read every used hit once, walking through memory in order
+    fPeakTime.assign(n_dense,0);
+    fPeakAmplitude.assign(n_dense,0);
+    fIntegral.assign(n_dense,0);
+    fNUnique = 0; fNShared = 0; fUniqueIntegral = 0;
+    for(auto const& p : fProducts)
+      for(size_t key=0; key<p.size; ++key){
+	size_t const i_h = p.offset+key;
+	if(fNClusters[i_h]==0) continue;
+	recob::Hit const& hit = p.base[key];
+	fPeakTime[i_h]      = hit.PeakTime();
+	fPeakAmplitude[i_h] = hit.PeakAmplitude();
+	fIntegral[i_h]      = hit.Integral();
+
+	++fNUnique;
+	if(fNClusters[i_h]>1) ++fNShared;
+	fUniqueIntegral += fIntegral[i_h];
+      }
+  }
+
+  size_t NClusters() const { return fClusterOffsets.size()-1; }
+
+  //the hits of a cluster, as sorted dense indices: [ClusterBegin(i_c),ClusterEnd(i_c)).
+  //Repeated associations are kept.
+  size_t const* ClusterBegin(size_t i_c) const { return fClusterHits.data()+fClusterOffsets[i_c]; }
+  size_t const* ClusterEnd(size_t i_c)   const { return fClusterHits.data()+fClusterOffsets[i_c+1]; }
+  size_t        ClusterSize(size_t i_c)  const { return fClusterOffsets[i_c+1]-fClusterOffsets[i_c]; }
+
+  //per hit, by dense index
+  float    PeakTime(size_t i_h)      const { return fPeakTime[i_h]; }
+  float    PeakAmplitude(size_t i_h) const { return fPeakAmplitude[i_h]; }
+  float    Integral(size_t i_h)      const { return fIntegral[i_h]; }
+  unsigned NClustersOf(size_t i_h)   const { return fNClusters[i_h]; }
+  bool     IsShared(size_t i_h)      const { return fNClusters[i_h]>1; }
+
+  //event totals, each hit counted once
+  size_t NUniqueHits()    const { return fNUnique; }
+  size_t NSharedHits()    const { return fNShared; }
+  double UniqueIntegral() const { return fUniqueIntegral; }
+
+private:
+
+  struct Product{
+    art::ProductID    id;
+    recob::Hit const* base;   //the start of that hit collection in memory
+    size_t            size;   //largest key we saw, plus one
+    size_t            offset; //where its block of dense indices starts
+  };
+
+  //there's almost always just one, so a linear search is fine
+  size_t FindProduct(art::Ptr<recob::Hit> const& ptr){
+    for(size_t i_p=0; i_p<fProducts.size(); ++i_p)
+      if(fProducts[i_p].id==ptr.id()) return i_p;
+    //first hit from this collection: work out where the collection is from it
+    fProducts.push_back( Product{ptr.id(),ptr.get()-ptr.key(),0,0} );
+    return fProducts.size()-1;
+  }
+
+  std::vector<Product>  fProducts;
+  std::vector<size_t>   fClusterOffsets;
+  std::vector<size_t>   fClusterHits;
+  std::vector<uint32_t> fNClusters; //clusters per hit: 16 bits could wrap in a busy event
+  std::vector<float>    fPeakTime;
+  std::vector<float>    fPeakAmplitude;
+  std::vector<float>    fIntegral;
+  size_t                fNUnique = 0;
+  size_t                fNShared = 0;
+  double                fUniqueIntegral = 0;
+};
+
+#endif
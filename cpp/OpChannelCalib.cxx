@@ -0,0 +1,227 @@
+/*************************************************************
+ *
+ * OpChannelCalib class
+ *
+ * Per-OpChannel calibration numbers, collected while we loop
+ * over the flashes anyway. See OpChannelCalib.hh.
+ *
+ *************************************************************/
+
+
+#include "OpChannelCalib.hh"
+
+//some standard C++ includes
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+//some ROOT includes
+#include "TTree.h"
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TString.h"
+
+opdet::OpChannelCalib::OpChannelCalib(int n_pe_bins, double pe_min, double pe_max)
+  : fNPEBins(n_pe_bins), fPEMin(pe_min), fPEMax(pe_max),
+    fSpectrumStride( ((n_pe_bins+2+15)/16)*16 ), //16 uint32_t per cache line
+    fNEvents(0)
+{}
+
+void opdet::OpChannelCalib::ChannelStats::Merge(ChannelStats const& other)
+{
+  if(other.n_hits==0) return;
+  ULong64_t n = n_hits+other.n_hits;
+  double delta = other.mean_time-mean_time;
+  mean_time += delta*other.n_hits/n;
+  m2_time   += other.m2_time + delta*delta*n_hits*other.n_hits/n;
+  n_hits     = n;
+  sum_pe    += other.sum_pe;
+  sum_pe2   += other.sum_pe2;
+}
+
+void opdet::OpChannelCalib::Resize(size_t n_chan)
+{
+  if(n_chan<=fStats.size()) return;
+  fStats.resize(n_chan);
+  fSpectrum.resize(n_chan*fSpectrumStride,0);
+}
+
+void opdet::OpChannelCalib::AddHit(int chan, double pe, double time)
+{
+  if(chan<0) return;
+  Resize(chan+1);
+
+  auto & stats = fStats[chan];
+  ++stats.n_hits;
+  stats.sum_pe  += pe;
+  stats.sum_pe2 += pe*pe;
+  double delta = time-stats.mean_time;
+  stats.mean_time += delta/stats.n_hits;
+  stats.m2_time   += delta*(time-stats.mean_time);
+
+  //same bin numbering as a TH1: 0 is underflow, fNPEBins+1 is overflow
+  int bin;
+  if(!(pe>=fPEMin)) bin = 0;
+  else if(pe>=fPEMax) bin = fNPEBins+1;
+  else bin = 1 + int(fNPEBins*(pe-fPEMin)/(fPEMax-fPEMin));
+  ++Spectrum(chan)[bin];
+}
+
+void opdet::OpChannelCalib::ProcessFlashes(std::vector<recob::OpFlash> const& opflash_vec,
+					   std::vector< std::vector<recob::OpHit const*> > const& ophits_vecs)
+{
+  ++fNEvents;
+  for (size_t i_f = 0, size_flash = opflash_vec.size(); i_f != size_flash; ++i_f)
+    for(auto const& ophitptr : ophits_vecs[i_f])
+      AddHit(ophitptr->OpChannel(),ophitptr->PE(),ophitptr->PeakTime());
+}
+
+void opdet::OpChannelCalib::Merge(OpChannelCalib const& other)
+{
+  if(other.fNPEBins!=fNPEBins || other.fPEMin!=fPEMin || other.fPEMax!=fPEMax)
+    throw std::runtime_error("OpChannelCalib::Merge: different PE binning");
+
+  fNEvents += other.fNEvents;
+  Resize(other.fStats.size());
+  for(size_t i_ch=0; i_ch<other.fStats.size(); ++i_ch){
+    fStats[i_ch].Merge(other.fStats[i_ch]);
+    for(int i_b=0; i_b<fNPEBins+2; ++i_b)
+      Spectrum(i_ch)[i_b] += other.Spectrum(i_ch)[i_b];
+  }
+}
+
+void opdet::OpChannelCalib::Write(TDirectory* dir) const
+{
+  TDirectory* old_dir = gDirectory;
+  dir->cd();
+
+  //job-level info, so we can merge these later
+  ULong64_t n_events = fNEvents;
+  int n_pe_bins = fNPEBins;
+  double pe_min = fPEMin, pe_max = fPEMax;
+  TTree* t_info = new TTree("opchancalib_info","OpChannel calibration info");
+  t_info->Branch("n_events",&n_events,"n_events/l");
+  t_info->Branch("n_pe_bins",&n_pe_bins,"n_pe_bins/I");
+  t_info->Branch("pe_min",&pe_min,"pe_min/D");
+  t_info->Branch("pe_max",&pe_max,"pe_max/D");
+  t_info->Fill();
+  t_info->Write();
+  delete t_info;
+
+  //one entry per channel: the raw sums (for merging), and the numbers you actually want
+  int chan;
+  ChannelStats stats;
+  double hit_rate, pe_mean, pe_rms, time_rms;
+  std::vector<uint32_t> spectrum(fNPEBins+2);
+  TTree* t_calib = new TTree("opchancalib","OpChannel calibration");
+  t_calib->Branch("chan",&chan,"chan/I");
+  t_calib->Branch("n_hits",&stats.n_hits,"n_hits/l");
+  t_calib->Branch("sum_pe",&stats.sum_pe,"sum_pe/D");
+  t_calib->Branch("sum_pe2",&stats.sum_pe2,"sum_pe2/D");
+  t_calib->Branch("time_mean",&stats.mean_time,"time_mean/D");
+  t_calib->Branch("time_m2",&stats.m2_time,"time_m2/D");
+  t_calib->Branch("hit_rate",&hit_rate,"hit_rate/D");
+  t_calib->Branch("pe_mean",&pe_mean,"pe_mean/D");
+  t_calib->Branch("pe_rms",&pe_rms,"pe_rms/D");
+  t_calib->Branch("time_rms",&time_rms,"time_rms/D");
+  t_calib->Branch("pe_spectrum",spectrum.data(),TString::Format("pe_spectrum[%d]/i",fNPEBins+2));
+
+  int n_chan = fStats.size();
+  TH2F* h_pe   = new TH2F("h_opchan_pe","OpHit PE per channel;OpChannel;PE",
+			  n_chan,-0.5,n_chan-0.5,fNPEBins,fPEMin,fPEMax);
+
+  for(chan=0; chan<n_chan; ++chan){
+    stats = fStats[chan];
+    if(stats.n_hits==0) continue;
+
+    hit_rate = fNEvents>0? double(stats.n_hits)/fNEvents : 0;
+    pe_mean  = stats.sum_pe/stats.n_hits;
+    pe_rms   = std::sqrt(std::max(0.,stats.sum_pe2/stats.n_hits-pe_mean*pe_mean));
+    time_rms = TimeRMS(stats);
+    std::copy(Spectrum(chan),Spectrum(chan)+fNPEBins+2,spectrum.begin());
+    t_calib->Fill();
+
+    for(int i_b=0; i_b<fNPEBins+2; ++i_b)
+      h_pe->SetBinContent(chan+1,i_b,spectrum[i_b]);
+  }
+
+  t_calib->Write();
+  delete t_calib;
+  h_pe->Write();
+  delete h_pe;
+
+  old_dir->cd();
+}
+
+void opdet::OpChannelCalib::WriteSummary(TDirectory* dir) const
+{
+  TDirectory* old_dir = gDirectory;
+  dir->cd();
+
+  int n_chan = fStats.size();
+  TH1F* h_time = new TH1F("h_opchan_time","OpHit mean peak time per channel;OpChannel;Mean peak time (#mus)",
+			  n_chan,-0.5,n_chan-0.5);
+  TH1F* h_rate = new TH1F("h_opchan_rate","OpHits per event per channel;OpChannel;OpHits / event",
+			  n_chan,-0.5,n_chan-0.5);
+
+  for(int chan=0; chan<n_chan; ++chan){
+    auto const& stats = fStats[chan];
+    if(stats.n_hits==0) continue;
+    h_time->SetBinContent(chan+1,stats.mean_time);
+    h_time->SetBinError(chan+1,TimeRMS(stats)/std::sqrt(stats.n_hits));
+    h_rate->SetBinContent(chan+1,fNEvents>0? double(stats.n_hits)/fNEvents : 0);
+  }
+
+  h_time->Write();
+  h_rate->Write();
+  delete h_time; delete h_rate;
+
+  old_dir->cd();
+}
+
+void opdet::OpChannelCalib::Merge(TDirectory* dir)
+{
+  TTree* t_info = nullptr;
+  TTree* t_calib = nullptr;
+  dir->GetObject("opchancalib_info",t_info);
+  dir->GetObject("opchancalib",t_calib);
+  if(!t_info || !t_calib)
+    throw std::runtime_error(std::string("OpChannelCalib::Merge: no opchancalib in ")+dir->GetName());
+
+  //(hadd-ed files have more than one info entry)
+  ULong64_t n_events;
+  int n_pe_bins;
+  double pe_min, pe_max;
+  t_info->SetBranchAddress("n_events",&n_events);
+  t_info->SetBranchAddress("n_pe_bins",&n_pe_bins);
+  t_info->SetBranchAddress("pe_min",&pe_min);
+  t_info->SetBranchAddress("pe_max",&pe_max);
+  for(Long64_t i_e=0; i_e<t_info->GetEntries(); ++i_e){
+    t_info->GetEntry(i_e);
+    if(n_pe_bins!=fNPEBins || pe_min!=fPEMin || pe_max!=fPEMax)
+      throw std::runtime_error("OpChannelCalib::Merge: different PE binning");
+    fNEvents += n_events;
+  }
+
+  int chan;
+  ChannelStats stats;
+  std::vector<uint32_t> spectrum(fNPEBins+2);
+  t_calib->SetBranchAddress("chan",&chan);
+  t_calib->SetBranchAddress("n_hits",&stats.n_hits);
+  t_calib->SetBranchAddress("sum_pe",&stats.sum_pe);
+  t_calib->SetBranchAddress("sum_pe2",&stats.sum_pe2);
+  t_calib->SetBranchAddress("time_mean",&stats.mean_time);
+  t_calib->SetBranchAddress("time_m2",&stats.m2_time);
+  t_calib->SetBranchAddress("pe_spectrum",spectrum.data());
+  for(Long64_t i_e=0; i_e<t_calib->GetEntries(); ++i_e){
+    t_calib->GetEntry(i_e);
+    Resize(chan+1);
+    fStats[chan].Merge(stats);
+    for(int i_b=0; i_b<fNPEBins+2; ++i_b)
+      Spectrum(chan)[i_b] += spectrum[i_b];
+  }
+
+  delete t_info;
+  delete t_calib;
+}
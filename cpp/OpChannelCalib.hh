@@ -0,0 +1,99 @@
+/*************************************************************
+ *
+ * OpChannelCalib class
+ *
+ * Per-OpChannel calibration numbers, collected while we loop
+ * over the flashes anyway: for every channel, the PE spectrum,
+ * the mean and spread of the hit peak time, and the number of
+ * hits per event. Only OpHits associated to flashes are used.
+ *
+ * Everything is in flat arrays indexed by channel, one cache
+ * line per channel. Merge() adds up the results of different
+ * threads, or (with a directory) of other jobs' output files.
+ *
+ * What Write() puts in a job's output is all sums, so it can be
+ * merged. Mean times and rates can't just be added up, so those
+ * histograms come from WriteSummary(), after merging: see
+ * demo_MergeOpChanCalib.
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_OPCHANNELCALIB_HH
+#define GALLERY_EXAMPLE_OPCHANNELCALIB_HH
+
+//some standard C++ includes
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+//some ROOT includes
+#include "Rtypes.h"
+#include "TDirectory.h"
+
+//"larsoft" object includes
+#include "lardataobj/RecoBase/OpFlash.h"
+#include "lardataobj/RecoBase/OpHit.h"
+
+//our own includes!
+#include "AlignedAllocator.h"
+
+namespace opdet { class OpChannelCalib; }
+
+class opdet::OpChannelCalib {
+
+public:
+
+  //binning of the per-channel PE spectrum
+  OpChannelCalib(int n_pe_bins=200, double pe_min=0, double pe_max=20);
+
+  void ProcessFlashes(std::vector<recob::OpFlash> const&,
+		      std::vector< std::vector<recob::OpHit const*> > const& );
+
+  //add up another one (another thread's), with the same PE binning
+  void Merge(OpChannelCalib const&);
+
+  //add up what another job wrote out with Write()
+  void Merge(TDirectory*);
+
+  //writes the 'opchancalib' tree (one entry per channel with hits) and the
+  //per-channel PE spectra into the directory. These can be merged with Merge(TDirectory*).
+  //(The tree also has each job's means and rms per channel, for a quick look.)
+  void Write(TDirectory*) const;
+
+  //writes the per-channel mean time and rate histograms. These are NOT sums, so
+  //don't hadd them: make them at the end, from everything merged together.
+  void WriteSummary(TDirectory*) const;
+
+private:
+
+  //running sums for one channel. Peak time uses Welford's method, so the
+  //variance stays good even for big times with a small spread.
+  struct alignas(64) ChannelStats{
+    ULong64_t n_hits;
+    double   sum_pe;
+    double   sum_pe2;
+    double   mean_time;
+    double   m2_time;
+    ChannelStats() : n_hits(0), sum_pe(0), sum_pe2(0), mean_time(0), m2_time(0) {}
+    void Merge(ChannelStats const&);
+  };
+
+  static double TimeRMS(ChannelStats const& s)
+  { return s.n_hits>1? std::sqrt(s.m2_time/(s.n_hits-1)) : 0; }
+
+  void AddHit(int chan, double pe, double time);
+  void Resize(size_t n_chan);
+  uint32_t* Spectrum(size_t chan) { return fSpectrum.data()+chan*fSpectrumStride; }
+  uint32_t const* Spectrum(size_t chan) const { return fSpectrum.data()+chan*fSpectrumStride; }
+
+  int    fNPEBins;
+  double fPEMin;
+  double fPEMax;
+  size_t fSpectrumStride; //n_pe_bins+2 (under/overflow), rounded up to a cache line
+
+  ULong64_t fNEvents;
+  std::vector< ChannelStats, util::AlignedAllocator<ChannelStats,64> > fStats;
+  std::vector< uint32_t, util::AlignedAllocator<uint32_t,64> >         fSpectrum;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*************************************************************
+ *
+ * ProductAccounting class
+ *
+ * Per-product I/O and memory bookkeeping for a gallery job.
+ * See ProductAccounting.hh for usage.
+ *
+ *************************************************************/
+
+
+#include "ProductAccounting.hh"
+
+//some standard C++ includes
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+
+//some ROOT includes
+#include "TFile.h"
+#include "TVirtualPerfStats.h"
+
+//our own includes!
+#include "ProductBranch.h"
+
+using namespace std::chrono;
+
+size_t util::ProductAccounting::CurrentRSS()
+{
+  //second number in statm is the resident set size, in pages
+  std::ifstream statm("/proc/self/statm");
+  size_t size_pages=0, rss_pages=0;
+  if(!(statm >> size_pages >> rss_pages)) return 0;
+  return rss_pages * sysconf(_SC_PAGESIZE);
+}
+
+util::ProductAccounting::Snapshot util::ProductAccounting::TakeSnapshot(gallery::Event const& ev)
+{
+  //new file, new event tree: hook up our perf stats to it.
+  if(FileChanged(ev,fFileEntry) || !fPerfStats)
+    fPerfStats.reset(new TTreePerfStats("ProductAccounting_ioperf",ev.getTTree()));
+
+  Snapshot snap;
+  snap.bytes_read = ev.getTFile()->GetBytesRead();
+  snap.disk_s     = fPerfStats->GetDiskTime();
+  snap.unzip_s    = fPerfStats->GetUnzipTime();
+  snap.time       = high_resolution_clock::now();
+  return snap;
+}
+
+void util::ProductAccounting::Record(gallery::Event const& ev, Snapshot const& before,
+				     std::string const& type, std::string const& label,
+				     art::InputTag const* tag, size_t mem)
+{
+  duration<double,std::milli> time_total_ms(high_resolution_clock::now()-before.time);
+  double disk_ms  = (fPerfStats->GetDiskTime()-before.disk_s)*1000.;
+  double unzip_ms = (fPerfStats->GetUnzipTime()-before.unzip_s)*1000.;
+
+  auto & stats = fStats[type+" "+label];
+  if(stats.n_reads==0){ stats.type = type; stats.tag = label; }
+  ++stats.n_reads;
+
+  stats.bytes_read += ev.getTFile()->GetBytesRead()-before.bytes_read;
+
+  //the branch sizes only change from file to file
+  if(tag && FileChanged(ev,stats.file_entry)){
+    TBranch* br = FindProductBranch(ev.getTTree(),type,*tag);
+    stats.zip_per_entry   = ZipBytesPerEntry(br);
+    stats.unzip_per_entry = TotBytesPerEntry(br);
+  }
+  stats.zip_bytes   += stats.zip_per_entry;
+  stats.unzip_bytes += stats.unzip_per_entry;
+
+  stats.disk_ms        += disk_ms;
+  stats.unzip_ms       += unzip_ms;
+  stats.deserialize_ms += std::max(0.,time_total_ms.count()-disk_ms-unzip_ms);
+  stats.total_ms       += time_total_ms.count();
+
+  if(mem==kUnknownSize)
+    stats.mem_known = false;
+  else{
+    stats.mem_bytes     += mem;
+    stats.max_mem_bytes  = std::max(stats.max_mem_bytes,(double)mem);
+  }
+
+  fEventPeakRSS = std::max(fEventPeakRSS,CurrentRSS());
+}
+
+void util::ProductAccounting::EndEvent(gallery::Event const& ev)
+{
+  if(!fEnabled) return;
+
+  //last event in this file: let go of the perf stats now, while its file and tree are
+  //still there. Otherwise gallery's next() would report the new file's reads to it.
+  if(fPerfStats && ev.eventEntry()+1>=ev.numberOfEventsInFile()){
+    ev.getTTree()->SetPerfStats(nullptr);
+    if(gPerfStats==fPerfStats.get()) gPerfStats = nullptr;
+    fPerfStats.reset();
+  }
+
+  fEventPeakRSS = std::max(fEventPeakRSS,CurrentRSS());
+  fPeakRSSPerEvent.push_back(fEventPeakRSS);
+  fEventPeakRSS = 0;
+
+  std::stringstream ss;
+  ss << ev.eventAuxiliary().run() << ":"
+     << ev.eventAuxiliary().subRun() << ":"
+     << ev.eventAuxiliary().event();
+  fEventIDs.push_back(ss.str());
+}
+
+void util::ProductAccounting::PrintReport(std::ostream& os) const
+{
+  if(!fEnabled) return;
+
+  //slowest products first
+  std::vector<ProductStats const*> sorted;
+  for(auto const& s : fStats) sorted.push_back(&s.second);
+  std::sort(sorted.begin(),sorted.end(),
+	    [](ProductStats const* a, ProductStats const* b){ return a->total_ms > b->total_ms; });
+
+  os << "ProductAccounting report (per product, summed over events; sizes in kB, times in ms)\n";
+  os << std::left << std::setw(40) << "type" << std::setw(30) << "tag"
+     << std::right << std::setw(8) << "reads"
+     << std::setw(12) << "read kB" << std::setw(12) << "zip kB" << std::setw(12) << "unzip kB"
+     << std::setw(10) << "disk" << std::setw(10) << "unzip" << std::setw(10) << "deser"
+     << std::setw(10) << "total" << std::setw(12) << "max mem kB" << "\n";
+  os << std::fixed << std::setprecision(1);
+  for(auto const& s : sorted){
+    os << std::left << std::setw(40) << s->type << std::setw(30) << s->tag
+       << std::right << std::setw(8) << s->n_reads
+       << std::setw(12) << s->bytes_read/1024. << std::setw(12) << s->zip_bytes/1024.
+       << std::setw(12) << s->unzip_bytes/1024.
+       << std::setw(10) << s->disk_ms << std::setw(10) << s->unzip_ms
+       << std::setw(10) << s->deserialize_ms << std::setw(10) << s->total_ms;
+    if(s->mem_known) os << std::setw(12) << s->max_mem_bytes/1024. << "\n";
+    else             os << std::setw(12) << "n/a" << "\n";
+  }
+
+  if(!fPeakRSSPerEvent.empty()){
+    size_t max_rss = *std::max_element(fPeakRSSPerEvent.begin(),fPeakRSSPerEvent.end());
+    double sum_rss=0;
+    for(auto rss : fPeakRSSPerEvent) sum_rss += rss;
+    os << "\tPeak RSS per event: mean " << sum_rss/fPeakRSSPerEvent.size()/1024./1024.
+       << " MB, max " << max_rss/1024./1024. << " MB over "
+       << fPeakRSSPerEvent.size() << " events\n";
+  }
+  os << std::flush;
+}
+
+void util::ProductAccounting::WriteCSV(std::string const& prefix) const
+{
+  if(!fEnabled) return;
+
+  std::ofstream f_products(prefix+"_products.csv");
+  f_products << "type,tag,n_reads,bytes_read,zip_bytes,unzip_bytes,"
+	     << "disk_ms,unzip_ms,deserialize_ms,total_ms,mem_bytes,max_mem_bytes\n";
+  for(auto const& st : fStats){
+    auto const& s = st.second;
+    f_products << s.type << "," << s.tag << "," << s.n_reads << ","
+	       << s.bytes_read << "," << s.zip_bytes << "," << s.unzip_bytes << ","
+	       << s.disk_ms << "," << s.unzip_ms << "," << s.deserialize_ms << ","
+	       << s.total_ms << ",";
+    if(s.mem_known) f_products << s.mem_bytes << "," << s.max_mem_bytes << "\n";
+    else            f_products << "n/a,n/a\n";
+  }
+
+  std::ofstream f_events(prefix+"_events.csv");
+  f_events << "event,peak_rss_bytes\n";
+  for(size_t i_ev=0; i_ev<fPeakRSSPerEvent.size(); ++i_ev)
+    f_events << fEventIDs[i_ev] << "," << fPeakRSSPerEvent[i_ev] << "\n";
+}
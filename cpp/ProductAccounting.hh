@@ -0,0 +1,182 @@
+/*************************************************************
+ *
+ * ProductAccounting class
+ *
+ * Per-product I/O and memory bookkeeping for a gallery job.
+ * Get your products through this instead of directly from the
+ * event, and it records, per InputTag and product type:
+ *   - bytes read from the file (compressed), and the branch's
+ *     compressed/uncompressed size per event
+ *   - time spent reading from disk, unzipping, and deserializing
+ *   - in-memory size of the product (for vectors and Assns;
+ *     "n/a" for other types, see MemSize)
+ * and per event, the peak resident memory (RSS).
+ *
+ * At the end, PrintReport() gives a table sorted by time, and
+ * WriteCSV() writes the same (plus the per-event memory) to
+ * files you can read in with a script.
+ *
+ * The bytes and times are what happens during each product's
+ * getValidHandle. gallery's TTreeCache reads the baskets of all
+ * the branches it has seen used in one go, and that would all
+ * get charged to whichever product came first. So make the
+ * gallery::Event with the cache off when you use this:
+ * gallery::Event ev(filenames,false).
+ *
+ * The disk/unzip times come from a TTreePerfStats on each file's
+ * event tree. It is made at our first read in that file, so it
+ * only covers what is read from then on, and we take it off
+ * again at the file's last event, before gallery closes it.
+ * Call EndEvent() at the end of every event for that.
+ *
+ * Made with enabled=false, it does nothing at all, and
+ * getValidHandle is just ev.getValidHandle.
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_PRODUCTACCOUNTING_HH
+#define GALLERY_EXAMPLE_PRODUCTACCOUNTING_HH
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <typeinfo>
+#include <chrono>
+#include <utility>
+
+//some ROOT includes
+#include "TTree.h"
+#include "TTreePerfStats.h"
+
+//"art" includes (canvas, and gallery)
+#include "canvas/Utilities/InputTag.h"
+#include "canvas/Utilities/TypeID.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Persistency/Common/Assns.h"
+#include "gallery/Event.h"
+#include "gallery/ValidHandle.h"
+
+namespace util { class ProductAccounting; }
+
+class util::ProductAccounting {
+
+public:
+
+  ProductAccounting(bool enabled=true) : fEnabled(enabled), fFileEntry(-1), fEventPeakRSS(0) {}
+
+  bool IsEnabled() const { return fEnabled; }
+
+  //use this like ev.getValidHandle<PROD>(tag).
+  template<class PROD>
+  gallery::ValidHandle<PROD> getValidHandle(gallery::Event const& ev, art::InputTag const& tag);
+
+  //for products we don't get by tag, but that get read for us behind our back
+  //(like the hits a FindMany/FindManyP resolves through the Assns Ptrs): counts
+  //what happens during func() as a read of 'type', with 'how' in the tag column.
+  template<class FUNC>
+  void Measure(gallery::Event const& ev, std::string const& type, std::string const& how, FUNC func);
+
+  //call this at the end of every event.
+  void EndEvent(gallery::Event const& ev);
+
+  void PrintReport(std::ostream&) const;
+
+  //writes <prefix>_products.csv and <prefix>_events.csv
+  void WriteCSV(std::string const& prefix) const;
+
+  //in-memory size of a product. For vectors we count what they hold,
+  //but not anything the elements themselves point to. For types we don't
+  //know how to measure, it's kUnknownSize, and the report says "n/a".
+  static constexpr size_t kUnknownSize = size_t(-1);
+  template<class T> static size_t MemSize(T const&) { return kUnknownSize; }
+  template<class T> static size_t MemSize(std::vector<T> const& v)
+  { return sizeof(v) + v.capacity()*sizeof(T); }
+
+  //Assns keep, per association, the pair of Ptrs, and for persistency a
+  //(RefCore,key) pair for each side. Plus the data, if there is any.
+  template<class L, class R, class D> static size_t MemSize(art::Assns<L,R,D> const& a)
+  { return sizeof(a) + a.size()*( AssnsPairSize<L,R>() + sizeof(D) ); }
+  template<class L, class R> static size_t MemSize(art::Assns<L,R> const& a)
+  { return sizeof(a) + a.size()*AssnsPairSize<L,R>(); }
+
+private:
+
+  struct ProductStats{
+    std::string   type;
+    std::string   tag;
+    unsigned long n_reads;
+    double bytes_read;    //measured from the file, compressed
+    double zip_bytes;     //from the branch, per event average, compressed
+    double unzip_bytes;   //from the branch, per event average, uncompressed
+    double disk_ms;
+    double unzip_ms;
+    double deserialize_ms;
+    double total_ms;
+    double mem_bytes;
+    double max_mem_bytes;
+    bool   mem_known;     //false if we can't measure this type
+    long long file_entry;       //the input file we last looked up the branch sizes in
+    double zip_per_entry;       //  and what we found there
+    double unzip_per_entry;
+    ProductStats() : n_reads(0), bytes_read(0), zip_bytes(0), unzip_bytes(0),
+		     disk_ms(0), unzip_ms(0), deserialize_ms(0), total_ms(0),
+		     mem_bytes(0), max_mem_bytes(0), mem_known(true),
+		     file_entry(-1), zip_per_entry(0), unzip_per_entry(0) {}
+  };
+
+  //what we look at before and after reading a product
+  struct Snapshot{
+    long long bytes_read;
+    double    disk_s;
+    double    unzip_s;
+    std::chrono::high_resolution_clock::time_point time;
+  };
+
+  template<class L, class R> static constexpr size_t AssnsPairSize()
+  { return sizeof(std::pair< art::Ptr<L>,art::Ptr<R> >) + 2*sizeof(std::pair<art::RefCore,size_t>); }
+
+  Snapshot TakeSnapshot(gallery::Event const& ev);
+
+  //tag is only there for products read by tag (to look up their branch sizes)
+  void     Record(gallery::Event const& ev, Snapshot const& before,
+		  std::string const& type, std::string const& label,
+		  art::InputTag const* tag, size_t mem);
+
+  static size_t CurrentRSS();
+
+  bool                            fEnabled;
+  std::map<std::string,ProductStats> fStats; //keyed on type + tag
+
+  long long                       fFileEntry; //the input file our perf stats are attached to
+  std::unique_ptr<TTreePerfStats> fPerfStats;
+
+  size_t                          fEventPeakRSS;
+  std::vector<size_t>             fPeakRSSPerEvent;
+  std::vector<std::string>        fEventIDs;
+};
+
+template<class PROD>
+gallery::ValidHandle<PROD> util::ProductAccounting::getValidHandle(gallery::Event const& ev,
+								   art::InputTag const& tag)
+{
+  if(!fEnabled) return ev.getValidHandle<PROD>(tag);
+  Snapshot before = TakeSnapshot(ev);
+  auto handle = ev.getValidHandle<PROD>(tag);
+  Record(ev,before,art::TypeID(typeid(PROD)).friendlyClassName(),tag.encode(),&tag,MemSize(*handle));
+  return handle;
+}
+
+template<class FUNC>
+void util::ProductAccounting::Measure(gallery::Event const& ev, std::string const& type,
+				      std::string const& how, FUNC func)
+{
+  if(!fEnabled){ func(); return; }
+  Snapshot before = TakeSnapshot(ev);
+  func();
+  Record(ev,before,type,how,nullptr,kUnknownSize);
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*************************************************************
+ *
+ * ProductBranch helpers
+ *
+ * Finding the Events tree branch that holds an art product
+ * (from its type and InputTag), its average size per event, and
+ * noticing when gallery has moved on to a new input file (and
+ * so to a new Events tree, with new branches).
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_PRODUCTBRANCH_H
+#define GALLERY_EXAMPLE_PRODUCTBRANCH_H
+
+//some standard C++ includes
+#include <string>
+#include <typeinfo>
+
+//some ROOT includes
+#include "TTree.h"
+#include "TBranch.h"
+#include "TObjArray.h"
+
+//"art" includes (canvas, and gallery)
+#include "canvas/Utilities/InputTag.h"
+#include "canvas/Utilities/TypeID.h"
+#include "gallery/Event.h"
+
+namespace util {
+
+  //art writes each product to its own branch in the Events tree, named like
+  //  friendlyClassName_moduleLabel_instanceName_processName.
+  //e.g. 'recob::Hits_gaushit__Reco.'. This finds that branch for an InputTag.
+  //If no process is given and more than one process made the product, we take
+  //the last one in the tree, which is normally the most recent one.
+  inline TBranch* FindProductBranch(TTree* tree,
+				    std::string const& friendly_name,
+				    art::InputTag const& tag){
+    if(!tree) return nullptr;
+
+    std::string const prefix = friendly_name + "_" + tag.label() + "_" + tag.instance() + "_";
+    TBranch* found = nullptr;
+
+    TObjArray* branches = tree->GetListOfBranches();
+    for(int i_b=0; i_b<branches->GetEntriesFast(); ++i_b){
+      TBranch* br = static_cast<TBranch*>(branches->UncheckedAt(i_b));
+      std::string name(br->GetName());
+      if(name.compare(0,prefix.size(),prefix)!=0) continue;
+
+      std::string process = name.substr(prefix.size());
+      if(!process.empty() && process.back()=='.') process.pop_back();
+      if(!tag.process().empty() && process!=tag.process()) continue;
+
+      found = br;
+    }
+    return found;
+  }
+
+  template<class PROD>
+  TBranch* FindProductBranch(TTree* tree, art::InputTag const& tag){
+    return FindProductBranch(tree,art::TypeID(typeid(PROD)).friendlyClassName(),tag);
+  }
+
+  //true (and updates last_file) if ev is in a different input file than last time.
+  //Anything you keep per file (branch pointers, sizes, perf stats) needs redoing then.
+  //Start last_file at -1. We go by the file number, not the TTree*: gallery deletes
+  //the old file's tree, and the new one can get the same address.
+  inline bool FileChanged(gallery::Event const& ev, long long& last_file){
+    if(ev.fileEntry()==last_file) return false;
+    last_file = ev.fileEntry();
+    return true;
+  }
+
+  //average compressed/uncompressed bytes per event for a product branch (and its sub-branches).
+  inline double ZipBytesPerEntry(TBranch* br){
+    if(!br || br->GetEntries()==0) return 0;
+    return (double)br->GetZipBytes("*") / br->GetEntries();
+  }
+  inline double TotBytesPerEntry(TBranch* br){
+    if(!br || br->GetEntries()==0) return 0;
+    return (double)br->GetTotBytes("*") / br->GetEntries();
+  }
+
+}
+
+#endif
@@ -12,6 +12,17 @@
 
 #include "SimpleOpFlashAna.hh"
 
+#include <stdexcept>
+
+#include "TString.h"
+
+void opdet::SimpleOpFlashAna::SetPEThresholds(std::vector<double> const& thresholds)
+{
+  fPEScan.reset(new util::ThresholdScan(thresholds));
+  fNHitsPEThr.resize(thresholds.size());
+  fIThr2PE = fPEScan->Index(2);
+}
+
 void opdet::SimpleOpFlashAna::InitROOTObjects(TTree *tree, TH1F* hist)
 {
   fFlashAnaTree = tree;
@@ -26,6 +37,17 @@ void opdet::SimpleOpFlashAna::InitROOTObjects(TTree *tree, TH1F* hist)
   fHistFlashPerEv->SetName("h_flash_per_ev");
   fHistFlashPerEv->SetTitle("OpFlashes per event;N_{flashes};Events / bin");
   fHistFlashPerEv->SetBins(20,-0.5,19.5);
+
+  //one branch entry and one histogram per PE threshold, if we have them
+  if(fPEScan && fPEScan->size()>0){
+    fFlashAnaTree->Branch("n_hits_pe_thr",fNHitsPEThr.data(),
+			  TString::Format("n_hits_pe_thr[%zu]/I",fPEScan->size()));
+    for(size_t i_t=0; i_t<fPEScan->size(); ++i_t)
+      fHistHitsPerFlashPEThr.push_back(new TH1F(TString::Format("h_ophits_per_flash_pe_thr%zu",i_t),
+						TString::Format("OpHits (> %g PE) per Flash;N_{optical hits};Events / bin",
+								fPEScan->Threshold(i_t)),
+						20,-0.5,19.5));
+  }
 }
 
 void opdet::SimpleOpFlashAna::ProcessFlashes(std::vector<recob::OpFlash> const& opflash_vec,
@@ -50,11 +72,22 @@ void opdet::SimpleOpFlashAna::ProcessFlashes(std::vector<recob::OpFlash> const&
     
     //loop over the optical hits, and fill that info too
     fFlashVals.n_hits_2pe=0;
+    if(fPEScan) fPEScan->Clear();
     for(size_t i_oph=0, size_hits = ophits_vec.size(); i_oph!=size_hits; ++i_oph){
       if(ophits_vec[i_oph]->PE()>2) ++fFlashVals.n_hits_2pe;
       fFlashVals.ophit_time[i_oph] = ophits_vec[i_oph]->PeakTime();
       fFlashVals.ophit_pe[i_oph]   = ophits_vec[i_oph]->PE();
       fFlashVals.ophit_chan[i_oph] = ophits_vec[i_oph]->OpChannel();
+      if(fPEScan) fPEScan->Add(ophits_vec[i_oph]->PE());
+    }
+
+    //now get the counts for all our thresholds at once
+    if(fPEScan){
+      fPEScan->Counts(fNHitsPEThr.data());
+      if(fIThr2PE>=0 && fNHitsPEThr[fIThr2PE]!=fFlashVals.n_hits_2pe)
+	throw std::runtime_error("SimpleOpFlashAna: ThresholdScan count at 2 PE doesn't match n_hits_2pe");
+      for(size_t i_t=0; i_t<fNHitsPEThr.size(); ++i_t)
+	fHistHitsPerFlashPEThr[i_t]->Fill(fNHitsPEThr[i_t]);
     }
     
     //fill the tree. set branch address on ophits to be safe.
@@ -11,6 +11,7 @@
 
 //some standard C++ includes
 #include <vector>
+#include <memory>
 
 //some ROOT includes
 #include "TTree.h"
@@ -20,6 +21,9 @@
 #include "lardataobj/RecoBase/OpFlash.h"
 #include "lardataobj/RecoBase/OpHit.h"
 
+//our own includes!
+#include "ThresholdScan.h"
+
 namespace opdet { class SimpleOpFlashAna; }
 
 const int MAXOPHIT = 50;
@@ -30,6 +34,10 @@ public:
     
   SimpleOpFlashAna(){}
   
+  //optional: a list of PE thresholds to count OpHits above, all in one pass.
+  //Call this before InitROOTObjects. If 2 PE is one of them, we check it against n_hits_2pe.
+  void SetPEThresholds(std::vector<double> const& thresholds);
+
   void InitROOTObjects(TTree *tree,TH1F* hist);
   void ProcessFlashes(std::vector<recob::OpFlash> const&,
 		      std::vector< std::vector<recob::OpHit const*> > const& );
@@ -60,4 +68,9 @@ private:
   OpFlashTreeObj_t fFlashVals;
   TTree*           fFlashAnaTree;
   TH1F*            fHistFlashPerEv;
+
+  std::unique_ptr<util::ThresholdScan> fPEScan;
+  std::vector<int>                     fNHitsPEThr;
+  int                                  fIThr2PE = -1;
+  std::vector<TH1F*>                   fHistHitsPerFlashPEThr;
 };
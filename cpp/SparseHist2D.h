@@ -0,0 +1,291 @@
+/*************************************************************
+ *
+ * SparseHist2D class
+ *
+ * A 2D histogram for very fine binning (mm in y-z, ns in time)
+ * where only a small part of the plane ever gets filled. A
+ * dense TH2F at that resolution would be hundreds of MB; this
+ * only keeps the 8x8 tiles of bins that were hit, in a hash
+ * map, so memory goes with how much of it is occupied.
+ *
+ * Tiles are small (512 bytes of contents) because fills are
+ * often scattered, one per tile. The sum of weights squared is
+ * only kept once a tile sees a weight that isn't 1: until then
+ * it is the same as the contents.
+ *
+ *   - Fill() is a bin lookup and a hash lookup (skipped if we
+ *     land in the same tile as last time).
+ *   - Add() merges another one (other threads, other jobs).
+ *   - Write()/Read() save it to and get it back from a ROOT
+ *     file. Read() adds the tiles up, so hadd-ed files just work.
+ *   - ToTH2F() gives you a normal dense TH2F for any sub-range.
+ *
+ * Bins are numbered from 0. Anything outside the range is
+ * only counted, in GetOutOfRange().
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_SPARSEHIST2D_H
+#define GALLERY_EXAMPLE_SPARSEHIST2D_H
+
+//some standard C++ includes
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+//some ROOT includes
+#include "TH2F.h"
+#include "TTree.h"
+#include "TDirectory.h"
+
+namespace util { class SparseHist2D; }
+
+class util::SparseHist2D {
+
+public:
+
+  static const int TILE = 8; //bins per tile side
+
+  SparseHist2D(int nx, double xlo, double xhi, int ny, double ylo, double yhi)
+    : fNX(nx), fXLo(xlo), fXHi(xhi), fNY(ny), fYLo(ylo), fYHi(yhi),
+      fInvDX(nx/(xhi-xlo)), fInvDY(ny/(yhi-ylo)),
+      fNTilesY((ny+TILE-1)/TILE),
+      fLastKey(-1), fLastTile(nullptr),
+      fEntries(0), fOutOfRange(0) {}
+
+  SparseHist2D(SparseHist2D && other) = default;
+
+  void Fill(double x, double y, double w=1){
+    ++fEntries;
+    //written so NaNs end up out of range too
+    if(!(x>=fXLo && x<fXHi && y>=fYLo && y<fYHi)){ fOutOfRange+=w; return; }
+    //same arithmetic as TAxis::FindBin, so we bin exactly like a TH2F would
+    int ix = std::min(int(fNX*(x-fXLo)/(fXHi-fXLo)),fNX-1);
+    int iy = std::min(int(fNY*(y-fYLo)/(fYHi-fYLo)),fNY-1);
+    auto & bin = GetTile(ix,iy);
+    int const i_bin = (ix%TILE)*TILE + (iy%TILE);
+    if(w!=1 && !bin.sumw2) bin.MakeSumw2();
+    bin.content[i_bin] += w;
+    if(bin.sumw2) bin.sumw2[i_bin] += w*w;
+  }
+
+  double GetBinContent(int ix, int iy) const{
+    Tile const* t = FindTile(ix,iy);
+    return t? t->content[(ix%TILE)*TILE + (iy%TILE)] : 0;
+  }
+  double GetBinError(int ix, int iy) const{
+    Tile const* t = FindTile(ix,iy);
+    return t? std::sqrt(t->Sumw2((ix%TILE)*TILE + (iy%TILE))) : 0;
+  }
+
+  double GetEntries()    const { return fEntries; }
+  double GetOutOfRange() const { return fOutOfRange; }
+  size_t GetNTiles()     const { return fTiles.size(); }
+
+  //roughly what we use: the tiles (and their sumw2, if they have one), plus what the
+  //hash map needs per tile.
+  size_t GetMemoryBytes() const{
+    size_t n_sumw2 = 0;
+    for(auto const& kt : fTiles) if(kt.second->sumw2) ++n_sumw2;
+    return sizeof(*this)
+      + fTiles.size()*(sizeof(Tile) + sizeof(Key_t) + sizeof(std::unique_ptr<Tile>) + 2*sizeof(void*))
+      + n_sumw2*TILE*TILE*sizeof(double)
+      + fTiles.bucket_count()*sizeof(void*);
+  }
+
+  //merge in another one with the same binning
+  void Add(SparseHist2D const& other){
+    if(!SameBinning(other))
+      throw std::runtime_error("SparseHist2D::Add: histograms have different binning");
+    for(auto const& kt : other.fTiles)
+      GetTileByKey(kt.first).Add(kt.second->content,kt.second->sumw2.get());
+    fEntries    += other.fEntries;
+    fOutOfRange += other.fOutOfRange;
+  }
+
+  //dense TH2F over [xlo,xhi) x [ylo,yhi), at our full resolution (snapped to our bin edges).
+  //The caller owns it.
+  TH2F* ToTH2F(const char* name, const char* title,
+	       double xlo, double xhi, double ylo, double yhi) const{
+    int ix0 = std::max(0,  int(std::floor((xlo-fXLo)*fInvDX)));
+    int ix1 = std::min(fNX,int(std::ceil ((xhi-fXLo)*fInvDX)));
+    int iy0 = std::max(0,  int(std::floor((ylo-fYLo)*fInvDY)));
+    int iy1 = std::min(fNY,int(std::ceil ((yhi-fYLo)*fInvDY)));
+    if(ix1<=ix0 || iy1<=iy0)
+      throw std::runtime_error("SparseHist2D::ToTH2F: empty range");
+
+    TH2F* h = new TH2F(name,title,
+		       ix1-ix0, fXLo+ix0/fInvDX, fXLo+ix1/fInvDX,
+		       iy1-iy0, fYLo+iy0/fInvDY, fYLo+iy1/fInvDY);
+    h->Sumw2();
+
+    //only look at the tiles we have, not at every bin in the range
+    for(auto const& kt : fTiles){
+      int tx = kt.first/fNTilesY, ty = kt.first%fNTilesY;
+      for(int jx=0; jx<TILE; ++jx){
+	int ix = tx*TILE+jx;
+	if(ix<ix0 || ix>=ix1) continue;
+	for(int jy=0; jy<TILE; ++jy){
+	  int iy = ty*TILE+jy;
+	  if(iy<iy0 || iy>=iy1) continue;
+	  double c = kt.second->content[jx*TILE+jy];
+	  double s2 = kt.second->Sumw2(jx*TILE+jy);
+	  if(c==0 && s2==0) continue;
+	  h->SetBinContent(ix-ix0+1,iy-iy0+1,c);
+	  h->SetBinError(ix-ix0+1,iy-iy0+1,std::sqrt(s2));
+	}
+      }
+    }
+    h->SetEntries(fEntries);
+    return h;
+  }
+
+  //save to the current directory: a '<name>_binning' tree, and a '<name>' tree with one entry per tile.
+  void Write(const char* name) const{
+    Binning b{fXLo,fXHi,fYLo,fYHi,fEntries,fOutOfRange,fNX,fNY};
+    TTree* t_binning = new TTree((std::string(name)+"_binning").c_str(),"SparseHist2D binning");
+    t_binning->Branch("binning",&b,"xlo/D:xhi/D:ylo/D:yhi/D:entries/D:out_of_range/D:nx/I:ny/I");
+    t_binning->Fill();
+    t_binning->Write();
+    delete t_binning;
+
+    //in the file, every tile has its sumw2
+    Long64_t key;
+    double content[TILE*TILE], sumw2[TILE*TILE];
+    TTree* t_tiles = new TTree(name,"SparseHist2D tiles");
+    t_tiles->Branch("key",&key,"key/L");
+    t_tiles->Branch("content",content,Form("content[%d]/D",TILE*TILE));
+    t_tiles->Branch("sumw2",sumw2,Form("sumw2[%d]/D",TILE*TILE));
+    for(auto const& kt : fTiles){
+      key = kt.first;
+      for(int i=0; i<TILE*TILE; ++i){
+	content[i] = kt.second->content[i];
+	sumw2[i]   = kt.second->Sumw2(i);
+      }
+      t_tiles->Fill();
+    }
+    t_tiles->Write();
+    delete t_tiles;
+  }
+
+  //get one back from a directory. If that file was hadd-ed, the tiles of all the jobs get added up
+  //(and they all need the same binning, or we throw).
+  static SparseHist2D Read(TDirectory* dir, const char* name){
+    TTree* t_binning = nullptr;
+    TTree* t_tiles = nullptr;
+    dir->GetObject((std::string(name)+"_binning").c_str(),t_binning);
+    dir->GetObject(name,t_tiles);
+    if(!t_binning || !t_tiles)
+      throw std::runtime_error(std::string("SparseHist2D::Read: no ")+name+" in "+dir->GetName());
+
+    Binning b;
+    t_binning->SetBranchAddress("binning",&b);
+    t_binning->GetEntry(0);
+    SparseHist2D h(b.nx,b.xlo,b.xhi,b.ny,b.ylo,b.yhi);
+    for(Long64_t i_e=0; i_e<t_binning->GetEntries(); ++i_e){
+      t_binning->GetEntry(i_e);
+      //every job we add up has to have used the same binning
+      if(b.nx!=h.fNX || b.ny!=h.fNY || b.xlo!=h.fXLo || b.xhi!=h.fXHi || b.ylo!=h.fYLo || b.yhi!=h.fYHi){
+	delete t_binning;
+	delete t_tiles;
+	throw std::runtime_error(std::string("SparseHist2D::Read: ")+name+" has jobs with different binning");
+      }
+      h.fEntries    += b.entries;
+      h.fOutOfRange += b.out_of_range;
+    }
+
+    Long64_t key;
+    double content[TILE*TILE], sumw2[TILE*TILE];
+    t_tiles->SetBranchAddress("key",&key);
+    t_tiles->SetBranchAddress("content",content);
+    t_tiles->SetBranchAddress("sumw2",sumw2);
+    for(Long64_t i_e=0; i_e<t_tiles->GetEntries(); ++i_e){
+      t_tiles->GetEntry(i_e);
+      //only keep a sumw2 for the tiles that need one
+      bool unweighted = std::equal(content,content+TILE*TILE,sumw2);
+      h.GetTileByKey(key).Add(content,unweighted? nullptr : sumw2);
+    }
+    delete t_binning;
+    delete t_tiles;
+    return h;
+  }
+
+private:
+
+  typedef long long Key_t;
+
+  struct Tile{
+    double content[TILE*TILE];
+    std::unique_ptr<double[]> sumw2; //nullptr while all weights were 1
+
+    Tile() { std::fill(content,content+TILE*TILE,0.); }
+
+    double Sumw2(int i) const { return sumw2? sumw2[i] : content[i]; }
+
+    //first weight that isn't 1: from here on we need to keep them separately
+    void MakeSumw2(){
+      sumw2.reset(new double[TILE*TILE]);
+      std::copy(content,content+TILE*TILE,sumw2.get());
+    }
+
+    //add another tile's numbers (other_sumw2 is nullptr if it's the same as other_content)
+    void Add(double const* other_content, double const* other_sumw2){
+      if(other_sumw2 && !sumw2) MakeSumw2();
+      for(int i=0; i<TILE*TILE; ++i){
+	if(sumw2) sumw2[i] += other_sumw2? other_sumw2[i] : other_content[i];
+	content[i] += other_content[i];
+      }
+    }
+  };
+
+  //must match the leaf list in Write() (and leaf lists don't pad, so doubles first)
+  struct Binning{ double xlo, xhi, ylo, yhi, entries, out_of_range; int nx, ny; };
+
+  Key_t KeyOf(int ix, int iy) const { return Key_t(ix/TILE)*fNTilesY + iy/TILE; }
+
+  Tile& GetTile(int ix, int iy){
+    Key_t key = KeyOf(ix,iy);
+    if(key==fLastKey) return *fLastTile;
+    Tile& t = GetTileByKey(key);
+    fLastKey = key;
+    fLastTile = &t;
+    return t;
+  }
+
+  Tile& GetTileByKey(Key_t key){
+    auto & ptr = fTiles[key];
+    if(!ptr) ptr.reset(new Tile());
+    return *ptr;
+  }
+
+  Tile const* FindTile(int ix, int iy) const{
+    if(ix<0 || ix>=fNX || iy<0 || iy>=fNY) return nullptr;
+    auto it = fTiles.find(KeyOf(ix,iy));
+    return it==fTiles.end()? nullptr : it->second.get();
+  }
+
+  bool SameBinning(SparseHist2D const& o) const{
+    return fNX==o.fNX && fXLo==o.fXLo && fXHi==o.fXHi && fNY==o.fNY && fYLo==o.fYLo && fYHi==o.fYHi;
+  }
+
+  int    fNX;
+  double fXLo, fXHi;
+  int    fNY;
+  double fYLo, fYHi;
+  double fInvDX, fInvDY;
+  int    fNTilesY;
+
+  std::unordered_map< Key_t,std::unique_ptr<Tile> > fTiles;
+
+  //the tile we filled last time: neighbouring fills are common, and this skips the hash lookup
+  Key_t  fLastKey;
+  Tile*  fLastTile;
+
+  double fEntries;
+  double fOutOfRange;
+};
+
+#endif
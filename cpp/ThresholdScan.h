@@ -0,0 +1,94 @@
+/*************************************************************
+ *
+ * ThresholdScan class
+ *
+ * Counts, for a whole list of thresholds at once, how many
+ * values are above each threshold. Use it to do a cut scan
+ * (like the number of OpHits with PE > X, for many X) in one
+ * pass instead of one job per X.
+ *
+ * Each Add() is a binary search over the (sorted) thresholds,
+ * and Counts() is one pass over the thresholds, so the cost for
+ * an object with N values is N*log(K) + K, not N*K.
+ *
+ * Counts use a strict '>', exactly like 'if(value>X) ++n', so
+ * each threshold gives the same answer as a dedicated run.
+ *
+ *************************************************************/
+
+#ifndef GALLERY_EXAMPLE_THRESHOLDSCAN_H
+#define GALLERY_EXAMPLE_THRESHOLDSCAN_H
+
+//some standard C++ includes
+#include <vector>
+#include <string>
+#include <algorithm>
+
+//our own includes!
+#include "ArgParser.h"
+
+namespace util { class ThresholdScan; }
+
+class util::ThresholdScan {
+
+public:
+
+  //thresholds can come in any order. Counts come back in the same order.
+  ThresholdScan(std::vector<double> const& thresholds)
+    : fThresholds(thresholds), fSorted(thresholds)
+  {
+    std::sort(fSorted.begin(),fSorted.end());
+    fSorted.erase(std::unique(fSorted.begin(),fSorted.end()),fSorted.end());
+
+    for(auto thr : fThresholds)
+      fToSorted.push_back(std::lower_bound(fSorted.begin(),fSorted.end(),thr)-fSorted.begin());
+
+    fBuckets.resize(fSorted.size()+1);
+    fSuffix.resize(fSorted.size()+1);
+    Clear();
+  }
+
+  size_t size() const { return fThresholds.size(); }
+  double Threshold(size_t i) const { return fThresholds[i]; }
+
+  //where threshold thr is in the list, or -1 if it's not there.
+  //Handy to check a count against the old hard-coded cut.
+  int Index(double thr) const {
+    for(size_t i=0; i<fThresholds.size(); ++i)
+      if(fThresholds[i]==thr) return i;
+    return -1;
+  }
+
+  //call this before each new object (flash, cluster, ...)
+  void Clear() { std::fill(fBuckets.begin(),fBuckets.end(),0); }
+
+  //fBuckets[j] counts the values that are above exactly the j lowest thresholds.
+  void Add(double value)
+  { ++fBuckets[std::lower_bound(fSorted.begin(),fSorted.end(),value)-fSorted.begin()]; }
+
+  //fills counts[i] with the number of values > Threshold(i). counts needs size() entries.
+  void Counts(int* counts) const {
+    fSuffix[fSorted.size()] = 0;
+    for(size_t j=fSorted.size(); j!=0; --j)
+      fSuffix[j-1] = fSuffix[j] + fBuckets[j];
+    for(size_t i=0; i<fThresholds.size(); ++i)
+      counts[i] = fSuffix[fToSorted[i]];
+  }
+
+  //the thresholds are the plain numbers on the command line, or the defaults if there are none.
+  //(Something that isn't a number is an error, with the usage line.)
+  static std::vector<double> FromArgs(util::ArgParser& args, std::vector<double> const& defaults){
+    std::vector<double> thresholds = args.GetPositional();
+    return thresholds.empty()? defaults : thresholds;
+  }
+
+private:
+
+  std::vector<double> fThresholds;
+  std::vector<double> fSorted;
+  std::vector<size_t> fToSorted;
+  std::vector<int>    fBuckets;
+  mutable std::vector<int> fSuffix;
+};
+
+#endif
@@ -0,0 +1,57 @@
+/*************************************************************
+ *
+ * demo_MergeOpChanCalib program
+ *
+ * Adds up the per-OpChannel calibration numbers from one or more
+ * demo_SimpleOpFlashAna output files (hadd-ed ones are fine too),
+ * and writes the merged numbers, plus the per-channel mean time
+ * and rate histograms made from them.
+ *
+ * To run: 'demo_MergeOpChanCalib out.root in_1.root [in_2.root ...]'
+ *
+ *************************************************************/
+
+
+//some standard C++ includes
+#include <iostream>
+#include <string>
+#include <memory>
+
+//some ROOT includes
+#include "TFile.h"
+#include "TDirectory.h"
+
+//our own includes!
+#include "OpChannelCalib.hh"
+
+//convenient for us! let's not bother with the std namespace!
+using namespace std;
+
+int main(int argc, char** argv) {
+
+  if(argc<3){
+    cout << "Usage: " << argv[0] << " out.root in_1.root [in_2.root ...]" << endl;
+    return 1;
+  }
+
+  //the binning has to match what demo_SimpleOpFlashAna used (Merge() checks)
+  opdet::OpChannelCalib calibAlg;
+  for(int i_arg=2; i_arg<argc; ++i_arg){
+    unique_ptr<TFile> f_input(TFile::Open(argv[i_arg],"READ"));
+    TDirectory* dir = nullptr;
+    if(f_input && !f_input->IsZombie()) f_input->GetObject("opchancalib",dir);
+    if(!dir){
+      cout << "No opchancalib directory in " << argv[i_arg] << endl;
+      return 1;
+    }
+    calibAlg.Merge(dir);
+    cout << "Added " << argv[i_arg] << endl;
+  }
+
+  TFile f_output(argv[1],"RECREATE");
+  TDirectory* dir = f_output.mkdir("opchancalib");
+  calibAlg.Write(dir);
+  calibAlg.WriteSummary(dir);
+  f_output.Close();
+
+}
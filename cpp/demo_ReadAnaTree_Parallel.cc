@@ -0,0 +1,103 @@
+/*************************************************************
+ *
+ * demo_ReadAnaTree_Parallel program
+ *
+ * This is a simple demonstration of reading back the
+ * flashanatree that demo_SimpleOpFlashAna (or
+ * demo_ReadOpFlashes_MakeTree) writes, using the
+ * AnaTreeReader on many threads at once.
+ *
+ * It runs the same job on 1, 2, 4, ... threads, and tells
+ * you how long each took, so you can see how it scales.
+ *
+ * To run: 'demo_ReadAnaTree_Parallel [file.root] [max_threads]'
+ *
+ *************************************************************/
+
+
+//some standard C++ includes
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+//some ROOT includes
+#include "TH1F.h"
+#include "TFile.h"
+
+//our own includes!
+#include "hist_utilities.h"
+#include "AnaTreeReader.hh"
+
+//convenient for us! let's not bother with the std namespace!
+using namespace std;
+
+using namespace std::chrono;
+
+int main(int argc, char** argv) {
+
+  string filename = argc>1? argv[1] : "demo_SimpleOpFlashAna_output.root";
+  unsigned int max_threads = argc>2? atoi(argv[2]) : std::thread::hardware_concurrency();
+  if(max_threads==0) max_threads=1;
+
+  util::FlashAnaTreeReader reader(filename);
+  cout << "Reading " << reader.GetEntries() << " flashes from " << filename << endl;
+
+  //Our histograms. The reader makes a copy per thread, and adds them back in here at the end.
+  TH1F h_flash_pe("h_flash_pe","Flash PEs; PE; Flashes / bin",100,0,500);
+  TH1F h_flash_time_bright("h_flash_time_bright","Flash Time (> 50 PE); time (#mus); Flashes / 0.5 #mus",60,-5,25);
+  TH1F h_ophit_pe("h_ophit_pe","OpHit PEs; PE; OpHits / 0.1 PE",100,0,10);
+  TH1F h_ophit_chan("h_ophit_chan","OpHit channel (> 2 PE); OpChannel; OpHits / bin",300,-0.5,299.5);
+
+  //what to fill, and (optionally) for which flashes
+  reader.AddHist(&h_flash_pe,[](util::FlashEntry const& f){ return f.pe; });
+  reader.AddHist(&h_flash_time_bright,
+		 [](util::FlashEntry const& f){ return f.time; },
+		 [](util::FlashEntry const& f){ return f.pe>50; });
+  reader.AddHistPerHit(&h_ophit_pe,[](util::FlashEntry const& f, int i){ return f.ophit_pe[i]; });
+  reader.AddHistPerHit(&h_ophit_chan,
+		       [](util::FlashEntry const& f, int i){ return f.ophit_pe[i]>2? f.ophit_chan[i] : -999; });
+
+  //now run it over and over, with more threads each time
+  double time_one_thread_ms=0;
+  for(unsigned int n_threads=1; n_threads<=max_threads; n_threads*=2){
+    h_flash_pe.Reset(); h_flash_time_bright.Reset(); h_ophit_pe.Reset(); h_ophit_chan.Reset();
+
+    auto t_begin = high_resolution_clock::now();
+    reader.Run(n_threads);
+    duration<double,std::milli> time_total_ms(high_resolution_clock::now()-t_begin);
+
+    if(n_threads==1) time_one_thread_ms = time_total_ms.count();
+    cout << "\t" << n_threads << " threads: " << time_total_ms.count() << " ms"
+	 << " (speedup " << time_one_thread_ms/time_total_ms.count() << ")" << endl;
+  }
+
+  //you can also do anything else with Reduce: here, the total PE seen by each channel.
+  auto pe_per_chan = reader.Reduce(max_threads, vector<double>(),
+				   [](vector<double>& acc, util::FlashEntry const& f){
+				     for(int i=0; i<f.n_hits; ++i){
+				       if(f.ophit_chan[i]<0) continue;
+				       if((size_t)f.ophit_chan[i]>=acc.size()) acc.resize(f.ophit_chan[i]+1);
+				       acc[f.ophit_chan[i]] += f.ophit_pe[i];
+				     }
+				   },
+				   [](vector<double>& result, vector<double> const& acc){
+				     if(acc.size()>result.size()) result.resize(acc.size());
+				     for(size_t i=0; i<acc.size(); ++i) result[i] += acc[i];
+				   });
+  cout << "Total PE seen in " << pe_per_chan.size() << " channels." << endl;
+
+  ShowUnderOverFlow(&h_flash_pe);
+  ShowUnderOverFlow(&h_ophit_pe);
+
+  //and ... write to file!
+  TFile f_output("demo_ReadAnaTree_Parallel_output.root","RECREATE");
+  h_flash_pe.Write();
+  h_flash_time_bright.Write();
+  h_ophit_pe.Write();
+  h_ophit_chan.Write();
+  f_output.Close();
+
+}
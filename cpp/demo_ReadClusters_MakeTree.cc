@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <stdexcept>
 
 //some ROOT includes
 #include "TInterpreter.h"
@@ -32,14 +33,22 @@
 #include "gallery/Event.h"
 #include "gallery/ValidHandle.h"
 #include "canvas/Persistency/Common/FindMany.h"
+#include "canvas/Persistency/Common/FindManyP.h"
 #include "canvas/Persistency/Common/FindOne.h"
+#include "canvas/Persistency/Common/Assns.h"
 
 //"larsoft" object includes
 #include "lardataobj/RecoBase/Cluster.h"
 #include "lardataobj/RecoBase/Hit.h"
+#include "lardataobj/RecoBase/OpFlash.h"
 
 //our own includes!
 #include "hist_utilities.h"
+#include "ArgParser.h"
+#include "EventSelector.h"
+#include "ProductAccounting.hh"
+#include "ThresholdScan.h"
+#include "HitWorkingSet.h"
 
 //convenient for us! let's not bother with art and std namespaces!
 using namespace art;
@@ -56,20 +65,23 @@ struct ClusterTreeObj{
   int    n_hits;
   int    n_hits_75;
   unsigned int index;
+  int    n_hits_shared; //not in the "cluster" leaf list: it has its own branch
 
   float hit_time[MAXHIT];
   float hit_amp[MAXHIT];
   float hit_integral[MAXHIT];
   
   void Clear() {
-    integral_sum=-9999; integral_ave=-9999; integral_std=-9999; n_hits=-1; n_hits_75=-1; index=999999;
+    integral_sum=-9999; integral_ave=-9999; integral_std=-9999; n_hits=-1; n_hits_75=-1; n_hits_shared=-1; index=999999;
     for(int i=0; i<MAXHIT; ++i)
       { hit_time[i]=-99999999; hit_amp[i] = -9999; hit_integral[i] = -9999; }
   }
   ClusterTreeObj() { Clear(); }
 };
 
-int main() {
+int main(int argc, char** argv) {
+
+  util::ArgParser args(argc,argv,"[integral thresholds ...] [--min-flash-pe=PE] [--accounting]");
 
   TFile f_output("demo_ReadClusters_output.root","RECREATE");
 
@@ -81,10 +93,37 @@ int main() {
   clusteranatree->Branch("hit_time",&cluster_vals.hit_time,"hit_time[n_hits]/F");
   clusteranatree->Branch("hit_amp",&cluster_vals.hit_amp,"hit_amp[n_hits]/F");
   clusteranatree->Branch("hit_integral",&cluster_vals.hit_integral,"hit_integral[n_hits]/F");
-  
+  clusteranatree->Branch("n_hits_shared",&cluster_vals.n_hits_shared,"n_hits_shared/I");
+
+  //Want to study that 75 ADC cut? Give a list of integral thresholds on the command line,
+  //like 'demo_ReadClusters_MakeTree 50 75 100', and we count hits above all of them in one pass.
+  util::ThresholdScan integral_scan(util::ThresholdScan::FromArgs(args,{ 75 }));
+  int const i_thr_75 = integral_scan.Index(75); //to check against n_hits_75
+  vector<int> n_hits_integral_thr(integral_scan.size());
+  clusteranatree->Branch("n_hits_integral_thr",n_hits_integral_thr.data(),
+			 Form("n_hits_integral_thr[%zu]/I",integral_scan.size()));
+
+
+  //and one entry per event, with totals over the clustered hits. A hit in two clusters
+  //counts twice in n_hits_clustered, but only once in the rest.
+  int n_clusters, n_hits_clustered, n_hits_unique, n_hits_shared;
+  double integral_clustered_unique;
+  TTree* clusterevtree = new TTree("clusterevtree","MyClusterEventTree");
+  clusterevtree->Branch("n_clusters",&n_clusters,"n_clusters/I");
+  clusterevtree->Branch("n_hits_clustered",&n_hits_clustered,"n_hits_clustered/I");
+  clusterevtree->Branch("n_hits_unique",&n_hits_unique,"n_hits_unique/I");
+  clusterevtree->Branch("n_hits_shared",&n_hits_shared,"n_hits_shared/I");
+  clusterevtree->Branch("integral_clustered_unique",&integral_clustered_unique,"integral_clustered_unique/D");
 
   //still gonna make this historgram
   TH1F* h_cluster_per_ev = new TH1F("h_cluster_per_ev","Clusters per event;N_{clusters};Events / bin",100,-0.5,99.5); 
+
+  //and one of these per integral threshold
+  vector<TH1F*> h_hits_per_cluster_integral_thr;
+  for(size_t i_t=0; i_t<integral_scan.size(); ++i_t)
+    h_hits_per_cluster_integral_thr.push_back(new TH1F(Form("h_hits_per_cluster_integral_thr%zu",i_t),
+						       Form("Hits (Integral > %g ADC) per Cluster;N_{hits};Events / bin",integral_scan.Threshold(i_t)),
+						       500,-0.5,499.5));
   
   //We specify our files in a list of file names!
   //Note: multiple files allowed. Just separate by comma.
@@ -102,6 +141,37 @@ int main() {
   //  'lar -c eventdump.fcl -s MyInputFile_1.root -n 1 | grep "std::vector<recob::Cluster>" '
   InputTag cluster_tag { "pandora" };
 
+  //The hits the clusters point to, and the flashes we use to select events.
+  InputTag hit_tag { "gaushit" };
+  InputTag opflash_tag { "opflashSat" };
+
+  //With '--accounting', this keeps track of how much time/bytes/memory each product
+  //costs us. Get products through it (instead of ev.getValidHandle) to have them counted.
+  //(When it's off, it just passes things through.)
+  util::ProductAccounting accounting(args.GetFlag("accounting"));
+
+  //If we only want some events, let's decide that first from cheap stuff, and only
+  //read the clusters, hits and associations for events we keep. Off by default:
+  //'--min-flash-pe=50' on the command line keeps only events with a flash above 50 PE.
+  //(Your file needs the flashes then!)
+  double min_flash_pe = args.GetDouble("min-flash-pe",-1);
+  args.Done();
+
+  util::EventSelector selector;
+  if(min_flash_pe>=0)
+    selector.AddCut(Form("flash with > %g PE",min_flash_pe),
+		    [&opflash_tag,&accounting,min_flash_pe](gallery::Event const& ev){
+		      for(auto const& flash : *accounting.getValidHandle<vector<recob::OpFlash>>(ev,opflash_tag))
+			if(flash.TotalPE()>min_flash_pe) return true;
+		      return false;
+		    });
+  selector.AddHeavyProduct< vector<recob::Cluster> >(cluster_tag);
+  selector.AddHeavyProduct< Assns<recob::Cluster,recob::Hit> >(cluster_tag);
+  selector.AddHeavyProduct< vector<recob::Hit> >(hit_tag);
+
+  //The per-event set of clustered hits. We keep it around between events, so it reuses its memory.
+  util::HitWorkingSet hit_set;
+
 
   //ok, now for the event loop! Here's how it works.
   //
@@ -112,8 +182,11 @@ int main() {
   //Do that until you are "atEnd()".
   //
   //In a for loop, that looks like this:
+  //
+  //(For the accounting, we turn off gallery's TTreeCache: it reads all the branches it
+  //has seen used at once, and we want the bytes charged to the product they belong to.)
 
-  for (gallery::Event ev(filenames) ; !ev.atEnd(); ev.next()) {
+  for (gallery::Event ev(filenames,!accounting.IsEnabled()) ; !ev.atEnd(); ev.next()) {
     auto t_begin = high_resolution_clock::now();
     
     //to get run and event info, you use this "eventAuxillary()" object.
@@ -121,10 +194,17 @@ int main() {
 	 << "Run " << ev.eventAuxiliary().run() << ", "
 	 << "Event " << ev.eventAuxiliary().event() << endl;
 
+    //check our cheap cuts before we read anything heavy.
+    if(!selector.Select(ev)){
+      cout << "\tFailed selection. Skipping." << endl;
+      accounting.EndEvent(ev);
+      continue;
+    }
+
     //Now, we want to get a "valid handle" (which is like a pointer to our collection")
     //We use auto, cause it's annoying to write out the fill type. But it's like
     //vector<recob::Cluster>* object.
-    auto const& cluster_handle = ev.getValidHandle<vector<recob::Cluster>>(cluster_tag);
+    auto const& cluster_handle = accounting.getValidHandle<vector<recob::Cluster>>(ev,cluster_tag);
 
     //We can now treat this like a pointer, or dereference it to have it be like a vector.
     //I (Wes) for some reason prefer the latter, so I always like to do ...
@@ -137,13 +217,31 @@ int main() {
     //We can fill our histogram for number of op hits now!!!
     h_cluster_per_ev->Fill(cluster_vec.size());
 
-    //We're gonna do this a tad differently now. Let's setup the FindMany, and run our loop
-    //over the handle, so we only do one loop;
-    FindMany<recob::Hit> hits_per_cluster(cluster_handle,ev,cluster_tag);
-    for (size_t i_c = 0, size_cluster = cluster_vec.size(); i_c != size_cluster; ++i_c) {
+    //FindManyP reads the associations for us, behind our back. Read them through the
+    //accounting first so they get counted: FindManyP then gets them for free.
+    accounting.getValidHandle< Assns<recob::Cluster,recob::Hit> >(ev,cluster_tag);
+
+    //We're gonna do this a tad differently now. Clusters share hits, so instead of
+    //following each cluster's hit pointers, we gather all the hits the clusters use
+    //once per event (FindManyP gives us art::Ptrs, which know their index in the hit
+    //collection), and then loop over the clusters using that.
+    //The hits get read when the Ptrs are first used, from whatever collection they
+    //point to, so that's what we count for them.
+    FindManyP<recob::Hit> hits_per_cluster(cluster_handle,ev,cluster_tag);
+    vector< util::HitWorkingSet::HitPtrs_t > hitptrs_per_cluster(cluster_vec.size());
+    for (size_t i_c = 0, size_cluster = cluster_vec.size(); i_c != size_cluster; ++i_c)
+      hits_per_cluster.get(i_c,hitptrs_per_cluster[i_c]);
+
+    accounting.Measure(ev,"recob::Hits","(resolved via Assns Ptrs)",
+		       [&](){ hit_set.Build(hitptrs_per_cluster); });
+
+    n_clusters = cluster_vec.size();
+    n_hits_clustered = 0;
+    n_hits_unique = hit_set.NUniqueHits();
+    n_hits_shared = hit_set.NSharedHits();
+    integral_clustered_unique = hit_set.UniqueIntegral();
 
-      std::vector<recob::Hit const*> hits_vec; //this will hold the output. Note it's a vec of ptrs.
-      hits_per_cluster.get(i_c,hits_vec); //This fills the output usting the findmany object.
+    for (size_t i_c = 0, size_cluster = cluster_vec.size(); i_c != size_cluster; ++i_c) {
 
       //initialize/clear out our tree objects
       cluster_vals.Clear();
@@ -154,29 +252,49 @@ int main() {
       cluster_vals.integral_ave = mycluster.IntegralAverage();
       cluster_vals.integral_std = mycluster.IntegralStdDev();
 
-      cluster_vals.n_hits = hits_vec.size();
+      cluster_vals.n_hits = hit_set.ClusterSize(i_c);
       cluster_vals.index = i_c;
+      n_hits_clustered += cluster_vals.n_hits;
       
-      //loop over the optical hits, and fill that info too
+      //loop over the hits, and fill that info too. They come in hit collection order
+      //(not association order).
       cluster_vals.n_hits_75=0;
-      for(size_t i_h=0, size_hits = hits_vec.size(); i_h!=size_hits; ++i_h){
-	if(hits_vec[i_h]->Integral()>75) ++cluster_vals.n_hits_75;
-	cluster_vals.hit_time[i_h] = hits_vec[i_h]->PeakTime();
-	cluster_vals.hit_amp[i_h]   = hits_vec[i_h]->PeakAmplitude();
-	cluster_vals.hit_integral[i_h] = hits_vec[i_h]->Integral();
+      cluster_vals.n_hits_shared=0;
+      integral_scan.Clear();
+      int i_h=0;
+      for(auto it = hit_set.ClusterBegin(i_c); it!=hit_set.ClusterEnd(i_c); ++it, ++i_h){
+	if(hit_set.Integral(*it)>75) ++cluster_vals.n_hits_75;
+	if(hit_set.IsShared(*it)) ++cluster_vals.n_hits_shared;
+	cluster_vals.hit_time[i_h] = hit_set.PeakTime(*it);
+	cluster_vals.hit_amp[i_h]   = hit_set.PeakAmplitude(*it);
+	cluster_vals.hit_integral[i_h] = hit_set.Integral(*it);
+	integral_scan.Add(hit_set.Integral(*it));
       }
 
+      //now all the thresholds at once
+      integral_scan.Counts(n_hits_integral_thr.data());
+      if(i_thr_75>=0 && n_hits_integral_thr[i_thr_75]!=cluster_vals.n_hits_75)
+	throw std::runtime_error("ThresholdScan count at 75 ADC doesn't match n_hits_75");
+      for(size_t i_t=0; i_t<integral_scan.size(); ++i_t)
+	h_hits_per_cluster_integral_thr[i_t]->Fill(n_hits_integral_thr[i_t]);
+
       //fill the tree. set branch address on ophits to be safe.
       clusteranatree->Fill();
 
     } //end loop over flashes
+
+    clusterevtree->Fill();
     
-    
+    accounting.EndEvent(ev);
+
     auto t_end = high_resolution_clock::now();
     duration<double,std::milli> time_total_ms(t_end-t_begin);
     cout << "\tEvent took " << time_total_ms.count() << " ms to process." << endl;
   } //end loop over events!
 
+  selector.PrintReport(cout);
+  accounting.PrintReport(cout);
+  accounting.WriteCSV("demo_ReadClusters_accounting");
 
   //and ... write to file!
   f_output.Write();
@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <stdexcept>
 
 //some ROOT includes
 #include "TInterpreter.h"
@@ -37,6 +38,10 @@
 
 //our own includes!
 #include "hist_utilities.h"
+#include "ArgParser.h"
+#include "ThresholdScan.h"
+#include "SparseHist2D.h"
+#include "EventSampler.hh"
 
 //convenient for us! let's not bother with art and std namespaces!
 using namespace art;
@@ -44,7 +49,9 @@ using namespace std;
 
 using namespace std::chrono;
 
-int main() {
+int main(int argc, char** argv) {
+
+  util::ArgParser args(argc,argv,"[PE thresholds ...] [--sample-fraction=F | --sample-count=N] [--seed=N]");
 
   TFile f_output("demo_ReadOpFlashes_output.root","RECREATE");
 
@@ -57,6 +64,24 @@ int main() {
   TH1F h_flash_time("h_flash_time","Flash Time; time (#mus); Events / 0.5 #mus",60,-5,25);
   TH1F h_ophits_per_flash("h_ophits_per_flash","OpHits per Flash;N_{optical hits};Events / bin",20,-0.5,19.5);
   TH1F h_ophits_per_flash_2pe("h_ophits_per_flash_2pe","OpHits (> 2 PE) per Flash;N_{optical hits};Events / bin",20,-0.5,19.5);
+
+  //Want to study that 2 PE cut? Give a list of PE thresholds on the command line,
+  //like 'demo_ReadOpFlashes 1 2 5 10', and we fill one histogram per threshold in one pass.
+  util::ThresholdScan pe_scan(util::ThresholdScan::FromArgs(args,{ 2 }));
+  int const i_thr_2 = pe_scan.Index(2); //to check against the 2 PE histogram
+  vector<TH1F> h_ophits_per_flash_pe_thr;
+  h_ophits_per_flash_pe_thr.reserve(pe_scan.size()); //no copying histograms around, please
+  for(size_t i_t=0; i_t<pe_scan.size(); ++i_t)
+    h_ophits_per_flash_pe_thr.emplace_back(Form("h_ophits_per_flash_pe_thr%zu",i_t),
+					   Form("OpHits (> %g PE) per Flash;N_{optical hits};Events / bin",pe_scan.Threshold(i_t)),
+					   20,-0.5,19.5);
+  vector<int> n_hits_pe_thr(pe_scan.size());
+
+  //For detector studies we want the flash maps at much finer binning: y-z at 1 mm, and
+  //time-PE at 1 ns x 0.1 PE. As dense TH2Fs those would be ~200 MB and ~2 GB, so we use
+  //sparse ones, that only keep the parts that get filled.
+  util::SparseHist2D h_flash_yz_fine(4000,-200,200,12000,-100,1100);
+  util::SparseHist2D h_flash_time_pe_fine(30000,-5,25,20000,0,2000);
   
   //We specify our files in a list of file names!
   //Note: multiple files allowed. Just separate by comma.
@@ -74,6 +99,20 @@ int main() {
   //  'lar -c eventdump.fcl -s MyInputFile_1.root -n 1 | grep opflash '
   InputTag opflash_tag { "opflashSat" };
 
+  //Just want a quick look? Run with '--sample-fraction=0.01' (or '--sample-count=1000'),
+  //and we only look at a random sample of events from all the files, and scale the
+  //histograms up to the full dataset at the end. Add '--seed=N' for a different sample.
+  //Without those options, this just gives every event, in order.
+  //(the ones we ShowUnderOverFlow at the end need to know, for the errors of the edge bins)
+  auto sampler = util::EventSampler::FromArgs(args,filenames);
+  args.Done();
+  sampler.PrintReport(cout);
+  for(auto h : { &h_flash_per_ev, &h_flash_pe, &h_flash_y, &h_flash_z, &h_flash_time, &h_ophits_per_flash })
+    sampler.PrepareHist(h,true);
+  sampler.PrepareHist(&h_ophits_per_flash_2pe);
+  for(auto & h : h_ophits_per_flash_pe_thr)
+    sampler.PrepareHist(&h,true);
+
 
   //ok, now for the event loop! Here's how it works.
   //
@@ -84,8 +123,13 @@ int main() {
   //Do that until you are "atEnd()".
   //
   //In a for loop, that looks like this:
+  //
+  //  for (gallery::Event ev(filenames) ; !ev.atEnd(); ev.next()) {
+  //
+  //Here, we let our sampler move us to the next event instead (without sampling
+  //options, that's just ev.next()):
 
-  for (gallery::Event ev(filenames) ; !ev.atEnd(); ev.next()) {
+  for (gallery::Event ev(filenames) ; sampler.GoToNext(ev); ) {
     auto t_begin = high_resolution_clock::now();
     
     //to get run and event info, you use this "eventAuxillary()" object.
@@ -124,6 +168,8 @@ int main() {
       h_flash_y.Fill(flash.YCenter());
       h_flash_z.Fill(flash.ZCenter());
       h_flash_time.Fill(flash.Time());
+      h_flash_yz_fine.Fill(flash.YCenter(),flash.ZCenter());
+      h_flash_time_pe_fine.Fill(flash.Time(),flash.TotalPE());
     }
 
     //We can also grab associated OpHits per OpFlash!
@@ -150,10 +196,20 @@ int main() {
 
       //we can loop over this ophit collection too!
       int nhits=0;
-      for(auto const& ophitptr : ophits_vec)
+      pe_scan.Clear();
+      for(auto const& ophitptr : ophits_vec){
 	if(ophitptr->PE()>2) ++nhits;
+	pe_scan.Add(ophitptr->PE());
+      }
       
       h_ophits_per_flash_2pe.Fill(nhits);
+
+      //and all our thresholds at once
+      pe_scan.Counts(n_hits_pe_thr.data());
+      if(i_thr_2>=0 && n_hits_pe_thr[i_thr_2]!=nhits)
+	throw std::runtime_error("ThresholdScan count at 2 PE doesn't match the > 2 PE count");
+      for(size_t i_t=0; i_t<pe_scan.size(); ++i_t)
+	h_ophits_per_flash_pe_thr[i_t].Fill(n_hits_pe_thr[i_t]);
     }
     
     auto t_end = high_resolution_clock::now();
@@ -162,14 +218,38 @@ int main() {
   } //end loop over events!
 
 
+  //if this was a preview, scale up to the full dataset (this is a no-op otherwise). The errors
+  //come from the event-to-event spread, so they're right for the per-flash histograms too.
+  //The fine sparse flash maps are left as they are: they are for detector studies, not previews.
+  for(auto h : { &h_flash_per_ev, &h_flash_pe, &h_flash_y, &h_flash_z, &h_flash_time,
+	&h_ophits_per_flash, &h_ophits_per_flash_2pe })
+    sampler.ScaleHist(h);
+  for(auto & h : h_ophits_per_flash_pe_thr)
+    sampler.ScaleHist(&h);
+  sampler.PrintReport(cout);
+
   //use this function to move under/overflow into visible bins.
   ShowUnderOverFlow(&h_flash_per_ev);
   ShowUnderOverFlow(&h_ophits_per_flash);
+  for(auto & h : h_ophits_per_flash_pe_thr)
+    ShowUnderOverFlow(&h);
   ShowUnderOverFlow(&h_flash_pe);
   ShowUnderOverFlow(&h_flash_y);
   ShowUnderOverFlow(&h_flash_z);
   ShowUnderOverFlow(&h_flash_time);
 
+  cout << "Fine flash maps: y-z uses " << h_flash_yz_fine.GetMemoryBytes()/1024./1024. << " MB, "
+       << "time-PE uses " << h_flash_time_pe_fine.GetMemoryBytes()/1024./1024. << " MB." << endl;
+
+  //save the whole sparse maps (SparseHist2D::Read gets them back, and adds up hadd-ed files)...
+  f_output.cd();
+  h_flash_yz_fine.Write("sparse_flash_yz");
+  h_flash_time_pe_fine.Write("sparse_flash_time_pe");
+
+  //...and, as an example, a normal TH2F of the middle of the detector, at full resolution.
+  //This one is in f_output, so it gets written below.
+  h_flash_yz_fine.ToTH2F("h_flash_yz_center","Flash y-z (center); y (cm); z (cm)",-50,50,450,550);
+
   //and ... write to file!
   f_output.Write();
   f_output.Close();
@@ -43,13 +43,19 @@
 #include "hist_utilities.h"
 
 #include "SimpleOpFlashAna.hh"
+#include "OpChannelCalib.hh"
+#include "FilePrefetcher.hh"
+#include "ThresholdScan.h"
+#include "ArgParser.h"
 
 //convenient for us! let's not bother with art and std namespaces!
 using namespace art;
 using namespace std;
 
 using namespace std::chrono;
-int main() {
+int main(int argc, char** argv) {
+
+  util::ArgParser args(argc,argv,"[PE thresholds ...] [--prefetch=N]");
 
   TFile f_output("demo_SimpleOpFlashAna_output.root","RECREATE");
 
@@ -57,14 +63,31 @@ int main() {
   TH1F*  myhist = new TH1F("myhist","MyHist",10,0,1);
 
   opdet::SimpleOpFlashAna anaAlg;
+
+  //count OpHits above each of these PE thresholds, all in one pass.
+  //Give them on the command line, like 'demo_SimpleOpFlashAna 1 2 5 10'.
+  anaAlg.SetPEThresholds(util::ThresholdScan::FromArgs(args,{ 2 }));
+
+  //and while we have all the flash OpHits, collect the per-channel calibration numbers too.
+  opdet::OpChannelCalib calibAlg;
   anaAlg.InitROOTObjects(mytree,myhist);
   
   //We specify our files in a list of file names, and our input tag
   vector<string> filenames { "MyInputFile_1.root" };
   InputTag opflash_tag { "opflashSat" };
 
+  //with lots of small files, opening each one is a big part of the job.
+  //This opens the next file(s) on a helper thread while we process the current one,
+  //and times the file boundaries. (For xrootd inputs, use 0 files in flight.)
+  //Note: make this before the gallery::Event, and use its Next() instead of ev.next().
+  //How many files to open ahead: '--prefetch=N' (default 2, 0 to just time the boundaries).
+  long long max_in_flight = args.GetInt("prefetch",2);
+  if(max_in_flight<0) args.Fail("'--prefetch' can't be negative");
+  util::FilePrefetcher prefetcher(filenames,max_in_flight);
+  args.Done();
+
   //ok, now for the event loop!
-  for (gallery::Event ev(filenames) ; !ev.atEnd(); ev.next()) {
+  for (gallery::Event ev(filenames) ; !ev.atEnd(); prefetcher.Next(ev)) {
     auto t_begin = high_resolution_clock::now();
     
     //to get run and event info, you use this "eventAuxillary()" object.
@@ -88,12 +111,18 @@ int main() {
 
     //fill our trees in our ana alg!
     anaAlg.ProcessFlashes(opflash_vec,ophits_vecs);
+    calibAlg.ProcessFlashes(opflash_vec,ophits_vecs);
     
     auto t_end = high_resolution_clock::now();
     duration<double,std::milli> time_total_ms(t_end-t_begin);
     cout << "\tEvent took " << time_total_ms.count() << " ms to process." << endl;
   } //end loop over events!
 
+  prefetcher.PrintReport(cout);
+
+  //per-channel sums go in their own directory. For the mean time and rate per channel,
+  //run 'demo_MergeOpChanCalib summary.root demo_SimpleOpFlashAna_output.root [more files]'.
+  calibAlg.Write(f_output.mkdir("opchancalib"));
 
   //and ... write to file!
   f_output.Write();
@@ -0,0 +1,105 @@
+/*************************************************************
+ *
+ * demo_SparseHist_Bench program
+ *
+ * Compares our SparseHist2D against a dense TH2F at the same
+ * (1 mm) resolution, for flash-like y-z positions: how fast
+ * we can fill them, and how much memory they take. It also
+ * checks that a dense sub-range from the sparse one matches
+ * the TH2F bin for bin. Then the worst case for the sparse one:
+ * fills scattered all over the plane, about one per tile.
+ *
+ * To run: 'demo_SparseHist_Bench [n_fills] [n_spots] [n_scattered]'
+ *
+ *************************************************************/
+
+
+//some standard C++ includes
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include <random>
+
+//some ROOT includes
+#include "TH2F.h"
+
+//our own includes!
+#include "SparseHist2D.h"
+
+//convenient for us! let's not bother with the std namespace!
+using namespace std;
+
+using namespace std::chrono;
+
+int main(int argc, char** argv) {
+
+  size_t n_fills = argc>1? atol(argv[1]) : 10000000;
+  size_t n_spots = argc>2? atol(argv[2]) : 200;
+  size_t n_scattered = argc>3? atol(argv[3]) : 100000;
+
+  //flash y-z, like in demo_ReadOpFlashes, but at 1 mm
+  int    ny = 4000;  double ylo = -200, yhi = 200;
+  int    nz = 12000; double zlo = -100, zhi = 1100;
+
+  //make up some flash positions: gaussian spots (say, where the light usually is) of a few cm
+  mt19937_64 rng(12345);
+  uniform_real_distribution<double> spot_y(ylo,yhi), spot_z(zlo,zhi);
+  vector< pair<double,double> > spots;
+  for(size_t i=0; i<n_spots; ++i) spots.emplace_back(spot_y(rng),spot_z(rng));
+
+  normal_distribution<double> smear(0.,3.);
+  uniform_int_distribution<size_t> pick(0,n_spots-1);
+  vector<double> ys(n_fills), zs(n_fills);
+  for(size_t i=0; i<n_fills; ++i){
+    auto const& s = spots[pick(rng)];
+    ys[i] = s.first+smear(rng);
+    zs[i] = s.second+smear(rng);
+  }
+
+  //dense
+  auto t_begin = high_resolution_clock::now();
+  TH2F h_dense("h_dense","Flash y-z;y (cm);z (cm)",ny,ylo,yhi,nz,zlo,zhi);
+  for(size_t i=0; i<n_fills; ++i) h_dense.Fill(ys[i],zs[i]);
+  duration<double,std::milli> time_dense_ms(high_resolution_clock::now()-t_begin);
+  double mem_dense = double(ny+2)*(nz+2)*sizeof(float);
+
+  //sparse
+  t_begin = high_resolution_clock::now();
+  util::SparseHist2D h_sparse(ny,ylo,yhi,nz,zlo,zhi);
+  for(size_t i=0; i<n_fills; ++i) h_sparse.Fill(ys[i],zs[i]);
+  duration<double,std::milli> time_sparse_ms(high_resolution_clock::now()-t_begin);
+  double mem_sparse = h_sparse.GetMemoryBytes();
+
+  cout << n_fills << " fills around " << n_spots << " spots, "
+       << ny << " x " << nz << " bins" << endl;
+  cout << "\tdense TH2F:   " << time_dense_ms.count() << " ms ("
+       << n_fills/time_dense_ms.count()/1000. << " M fills/s), "
+       << mem_dense/1024./1024. << " MB" << endl;
+  cout << "\tSparseHist2D: " << time_sparse_ms.count() << " ms ("
+       << n_fills/time_sparse_ms.count()/1000. << " M fills/s), "
+       << mem_sparse/1024./1024. << " MB in " << h_sparse.GetNTiles() << " tiles" << endl;
+
+  //and check the sparse one around the first spot against the dense one
+  double y0 = spots[0].first, z0 = spots[0].second;
+  TH2F* h_sub = h_sparse.ToTH2F("h_sub","",y0-10,y0+10,z0-10,z0+10);
+  int n_bad=0;
+  for(int i_y=1; i_y<=h_sub->GetNbinsX(); ++i_y)
+    for(int i_z=1; i_z<=h_sub->GetNbinsY(); ++i_z){
+      int i_bin = h_dense.FindBin(h_sub->GetXaxis()->GetBinCenter(i_y),h_sub->GetYaxis()->GetBinCenter(i_z));
+      if(h_dense.GetBinContent(i_bin)!=h_sub->GetBinContent(i_y,i_z)) ++n_bad;
+    }
+  cout << "\tSub-range check: " << n_bad << " bins differ" << endl;
+  delete h_sub;
+
+  //scattered: uniform over the whole plane, so nearly every fill starts a new tile
+  util::SparseHist2D h_scattered(ny,ylo,yhi,nz,zlo,zhi);
+  for(size_t i=0; i<n_scattered; ++i) h_scattered.Fill(spot_y(rng),spot_z(rng));
+  double mem_scattered = h_scattered.GetMemoryBytes();
+  cout << n_scattered << " scattered fills: SparseHist2D uses "
+       << mem_scattered/1024./1024. << " MB in " << h_scattered.GetNTiles() << " tiles ("
+       << mem_scattered/h_scattered.GetNTiles() << " bytes per tile), vs "
+       << mem_dense/1024./1024. << " MB dense" << endl;
+
+  return n_bad==0? 0 : 1;
+}